@@ -0,0 +1,65 @@
+/*
+ * autotune.h
+ *
+ * Relay feedback (Åström-Hägglund) auto-tuner for the fixed-point PID regulator
+ *
+ * USAGE:
+ * - Create an autotune object
+ * - Call autotune_start() with the setpoint, relay hysteresis and relay output levels
+ * - Call autotune_update() with every new measurement instead of pid_update(), use the returned output
+ * - Poll autotune_get_state(), when AUTOTUNE_DONE read the gains with autotune_get_gains()
+ *
+ * NOTES:
+ * - The relay drives the output between output_low and output_high around the setpoint
+ * - The first oscillation (heat up) is discarded, then the period and amplitude of
+ *   autotune_cycles oscillations are averaged
+ * - Gains are returned in pid.h units
+ * - No HAL dependency, the file can be compiled and tested on a host
+ */
+
+#ifndef INC_AUTOTUNE_H_
+#define INC_AUTOTUNE_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum autotune_states {
+	AUTOTUNE_IDLE = 0,
+	AUTOTUNE_RUNNING,
+	AUTOTUNE_DONE,
+	AUTOTUNE_FAILED
+};
+
+typedef struct {
+	int16_t setpoint;
+	int16_t hysteresis;		// relay switches at setpoint +/- hysteresis
+	int32_t output_low;
+	int32_t output_high;
+	uint8_t cycles_target;	// number of oscillations to average
+	uint32_t timeout_ms;
+
+	uint8_t state;
+	uint8_t relay_on;
+	uint8_t cycles;			// measured oscillations
+	uint8_t cycle_started;	// 1 after the first relay switch-on, measurements start there
+	int16_t peak_max;
+	int16_t peak_min;
+	uint32_t cycle_time_ms;
+	uint32_t elapsed_ms;
+	uint32_t period_sum_ms;
+	uint32_t amplitude_sum;	// sum of peak to peak amplitudes in °C
+
+	int32_t kp;
+	int32_t ki;
+	int32_t kd;
+} autotune;
+
+/******    Function Declarations    ******/
+void autotune_start(autotune *const self, int16_t setpoint, int16_t hysteresis, int32_t output_low, int32_t output_high, uint8_t cycles, uint32_t timeout_ms);
+void autotune_stop(autotune *const self);
+int32_t autotune_update(autotune *const self, int16_t measurement, uint16_t dt_ms);
+uint8_t autotune_get_state(autotune *const self);
+void autotune_get_gains(autotune *const self, int32_t *kp, int32_t *ki, int32_t *kd);
+
+#endif /* INC_AUTOTUNE_H_ */
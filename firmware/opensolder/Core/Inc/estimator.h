@@ -0,0 +1,55 @@
+/*
+ * estimator.h
+ *
+ * Fixed-point scalar Kalman filter estimating the tip temperature between thermocouple readings
+ *
+ * USAGE:
+ * - Create an estimator object
+ * - Call estimator_init() with the thermal model and noise parameters
+ * - Call estimator_predict() every AC half cycle with the heater energy of the half cycle that just ended
+ * - Call estimator_update() with every valid thermocouple reading
+ * - estimator_get_temperature() returns the current estimate, valid once estimator_is_initialized()
+ *
+ * NOTES:
+ * - First order thermal model: dT/dt = heat_rate * heater_on - (T - ambient) / cooling_time
+ * - heater_energy is the Q8 share of the step the heater was on (ESTIMATOR_HEATER_ON = on for the whole step)
+ * - Temperature is Q16 °C, variances are Q10 °C²
+ * - Readings further than ESTIMATOR_GATE_TEMP away from the estimate re-initialize the filter (tip change, errors)
+ * - No HAL dependency, the file can be compiled and tested on a host
+ */
+
+#ifndef INC_ESTIMATOR_H_
+#define INC_ESTIMATOR_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum estimator_internal_constants {
+	ESTIMATOR_VARIANCE_MAX = 65535,	// Q10, limits the variance so the Kalman gain calculation fits in 32 bit
+	ESTIMATOR_GATE_TEMP = 64,		// °C, innovation limit before the filter re-initializes to the reading
+	ESTIMATOR_HEATER_ON = 256,		// Q8 heater energy of a step with the heater on all the time
+	ESTIMATOR_HEATER_SHIFT = 8
+};
+
+typedef struct {
+	int32_t temperature;		// Q16 °C
+	uint32_t variance;			// Q10 °C²
+	int32_t heat_rate;			// Q16 °C per ms of heater on time
+	uint32_t cooling_time_ms;	// first order cooling time constant
+	uint32_t process_noise;		// Q10 °C² per ms
+	uint32_t measurement_noise;	// Q10 °C²
+	int16_t ambient;			// °C
+	uint8_t initialized;		// 0 until the first reading
+} estimator;
+
+/******    Function Declarations    ******/
+void estimator_init(estimator *const self, int32_t heat_rate, uint32_t cooling_time_ms, uint32_t process_noise, uint32_t measurement_noise, int16_t ambient);
+void estimator_reset(estimator *const self);
+void estimator_set_ambient(estimator *const self, int16_t ambient);
+void estimator_predict(estimator *const self, uint16_t heater_energy, uint16_t dt_ms);
+void estimator_update(estimator *const self, int16_t measurement);
+int16_t estimator_get_temperature(estimator *const self);
+uint8_t estimator_is_initialized(estimator *const self);
+
+#endif /* INC_ESTIMATOR_H_ */
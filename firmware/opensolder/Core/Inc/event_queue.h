@@ -0,0 +1,50 @@
+/*
+ * event_queue.h
+ *
+ * Lock-free single producer, single consumer ring buffer of typed events from an interrupt to the main loop
+ *
+ * USAGE:
+ * - Create an event_queue object per producer (interrupt)
+ * - Call event_queue_init() before the producer interrupt is enabled
+ * - The producer calls event_queue_push() with the event type and value
+ * - The consumer calls event_queue_pop() until it returns 0
+ *
+ * NOTES:
+ * - Exactly one producer and one consumer context per queue: the producer only writes head,
+ *   the consumer only writes tail, no interrupt lock is needed on the single core M0
+ * - The event is written before head is published, a signal fence keeps the compiler from reordering
+ * - A push to a full queue drops the new event and counts it in dropped
+ * - No HAL dependency, the file can be compiled and tested on a host
+ */
+
+#ifndef INC_EVENT_QUEUE_H_
+#define INC_EVENT_QUEUE_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum event_queue_constants {
+	EVENT_QUEUE_LENGTH = 16		// power of two, one slot stays free to tell full from empty
+};
+_Static_assert((EVENT_QUEUE_LENGTH & (EVENT_QUEUE_LENGTH - 1)) == 0, "EVENT_QUEUE_LENGTH must be a power of two");
+
+typedef struct {
+	uint8_t type;
+	int16_t value;
+} event;
+
+typedef struct {
+	event events[EVENT_QUEUE_LENGTH];
+	volatile uint8_t head;		// next slot to write, producer only
+	volatile uint8_t tail;		// next slot to read, consumer only
+	volatile uint16_t dropped;	// events lost to a full queue, producer only
+} event_queue;
+
+/******    Function Declarations    ******/
+void event_queue_init(event_queue *const self);
+uint8_t event_queue_push(event_queue *const self, uint8_t type, int16_t value);
+uint8_t event_queue_pop(event_queue *const self, event *const result);
+uint16_t event_queue_get_dropped(event_queue *const self);
+
+#endif /* INC_EVENT_QUEUE_H_ */
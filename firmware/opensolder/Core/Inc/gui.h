@@ -13,9 +13,10 @@
 #include "../../Drivers/ssd1306/inc/ssd1306.h"
 
 /******    Global Function Declarations    ******/
-void init_display(uint16_t timeout);
+void init_display(void);
 void update_display(void);
 void display_message(uint16_t message_code); // Use message code from opensolder_messages enum
 void draw_default_display(void);
+void flush_display(void);
 
 #endif
@@ -10,6 +10,7 @@
 
 #include "button.h"
 #include "encoder.h"
+#include "event_queue.h"
 #include "opensolder.h"
 
 enum hid_states {
@@ -30,5 +31,7 @@ void hid__poll(void);
 uint8_t hid__get_button_state(void);
 uint8_t hid__get_stand_state(void);
 uint8_t hid__get_tip_change_state(void);
+event_queue *hid__get_events(void);		// EVENT_BUTTON, EVENT_ENCODER, EVENT_TOOL_HOLDER (released after STANDBY_DELAY_MS)
+										// and EVENT_TIP_CHANGER (released after TIP_CHANGE_DELAY_MS), consumed by the state machine
 
 #endif /* INC_HID_H_ */
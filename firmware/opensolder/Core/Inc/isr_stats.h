@@ -0,0 +1,45 @@
+/*
+ * isr_stats.h
+ *
+ * Interrupt latency and duration statistics: count, min, max and a log2 histogram of µs values
+ *
+ * USAGE:
+ * - Create an isr_stats object per measured value (e.g. latency or duration of one interrupt)
+ * - Call isr_stats_reset() to start
+ * - Call isr_stats_record() from the interrupt with the value in µs
+ * - isr_stats_copy() takes a consistent copy while the interrupt keeps recording
+ * - isr_stats_format() prints the statistics (a copy) into a text line
+ *
+ * NOTES:
+ * - Histogram bucket n counts values from 2^(n-1) to 2^n - 1 µs, bucket 0 counts 0µs,
+ *   the last bucket everything above
+ * - isr_stats_record() is short and division free, it can be called from any interrupt
+ * - isr_stats_reset() and isr_stats_copy() need no interrupt lock: they retry until no record came in between
+ * - No HAL dependency, the file can be compiled and tested on a host
+ */
+
+#ifndef INC_ISR_STATS_H_
+#define INC_ISR_STATS_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum isr_stats_constants {
+	ISR_STATS_BUCKETS = 12		// 0µs, 1µs, 2-3µs, ... 512-1023µs, >= 1024µs
+};
+
+typedef struct {
+	uint32_t count;
+	uint16_t min;							// µs
+	uint16_t max;							// µs
+	uint16_t histogram[ISR_STATS_BUCKETS];	// saturating counters
+} isr_stats;
+
+/******    Function Declarations    ******/
+void isr_stats_reset(isr_stats *const self);
+void isr_stats_record(isr_stats *const self, uint16_t value_us);
+void isr_stats_copy(const isr_stats *const self, isr_stats *const copy);
+int isr_stats_format(const isr_stats *const self, const char *name, char *buffer, uint16_t length);
+
+#endif /* INC_ISR_STATS_H_ */
@@ -11,6 +11,16 @@
 /******    Includes    ******/
 #include "main.h"
 #include <stdint.h>
+#include "scheduler.h"
+
+/******    Build Options    ******/
+// Define OPENSOLDER_ISR_IN_RAM in the project preprocessor symbols to run the zero cross, heater switching
+// and ADC DMA interrupt fast paths from RAM (.RamFunc, copied at startup) instead of flash with a wait state
+#ifdef OPENSOLDER_ISR_IN_RAM
+#define OPENSOLDER_RAMFUNC __attribute__((section(".RamFunc")))
+#else
+#define OPENSOLDER_RAMFUNC
+#endif
 
 /******    Constants   ******/
 enum PCT2075_constants {
@@ -23,7 +33,7 @@ enum PCT2075_constants {
 };
 
 enum opensolder_constants {
-	TIP_CHECK_INTERVAL = 50,		   // Number of half mains cycles between each tip check (value of 50 cycles * 10ms = 500ms tipcheck interval)
+	TIP_CHECK_INTERVAL_MS = 500,	   // Time between each tip check, counted in mains half cycles
 	TIP_CHANGE_DELAY_MS = 2000,		   // Delay after tip_change_sense is set before turning heater on
 	DISPLAY_BRIGHTNESS = 255,		   // Sets display contrast/brightness, value 0-255
 	DISPLAY_UPDATE_TICKS = 500,		   // Refresh rate for updating tip_temp, set higher to remove jitter
@@ -32,18 +42,56 @@ enum opensolder_constants {
 	SPLASHSCREEN_TIMEOUT_MS = 1000,	   // Splash screen / boot screen, 0 to disable
 	DEFAULT_TEMP = 350,				   // Default set temp on startup
 	MAX_TEMP = 450,					   // Maximum allowable temperature
-	ABS_MAX_TEMP = 470,				   // Absolute maximum threshold to kill power immediately		// TODO: implement ABS max temp check to block heater output
+	ABS_MAX_TEMP = 470,				   // Absolute maximum threshold to kill power immediately (ADC analog watchdog, limited to ADC_NO_TIP_MIN_VALUE)
 	MIN_TEMP = 30,					   // Minimum allowable temperature
 	TEMP_STEPS = 5,					   // Number of degrees setTemp changes per encoder step
-	MAX_ON_PERIODS = 4,				   // Maximum number if AC half cycles the power should be on before next temp reading
+	MIN_ON_PERIODS = 2,				   // Heating AC half cycles between two temp readings close to set temp (tight control)
+	MAX_ON_PERIODS = 16,			   // Heating AC half cycles between two temp readings far from set temp (fast heat up). Hard limit for any run
+	POLARITY_BALANCE_MAX = 2,		   // Max difference of heating half cycles between the two mains polarities (transformer DC bias)
+	SIGMA_DELTA_BACKLOG_MAX = 4,	   // Heating half cycles of power demand kept while half cycles are deferred for the polarity balance
+	HEATER_PHASE_TABLE_LENGTH = 33,	   // Phase control power to on time table, 32 segments over the Q15 power
+	HEATER_PHASE_TABLE_SHIFT = 10,	   // Q15 power per table segment = 1 << HEATER_PHASE_TABLE_SHIFT
+	HEATER_PHASE_MIN_OFF_US = 200,	   // Phase control: shorter off times keep the heater on for the whole half cycle
+	ON_PERIODS_TEMP_BAND = 32,		   // °C from set temp where the heating run is scaled from MIN_ON_PERIODS up to MAX_ON_PERIODS
+	HEATER_STATS_WINDOW = 100,		   // Number of AC half cycles the effective heater duty and measurement rate are counted over
 	STANDBY_TEMP = 160,				   // Tip temperature when handle is in holder
 	STANDBY_TIME_S = 300,			   // Number of seconds to keep tip at elevated standby temperature, before turning heater off
 	STANDBY_DELAY_MS = 300,			   // Delay from lifting the tool holder before turning heater on
 	ADC_BUFFER_LENGTH = 50,			   // Number of ADC samples to take every reading
 	ADC_MAX_DEVIATION = 200,		   // Maximum deviation allowed in the ADC sample buffer. Any value out of range gives the reading an error
 	ADC_NO_TIP_MIN_VALUE = 4000,	   // Lowest expected temp reading with no tip inserted and TIP_CHECK pin high. Used for tip detection
-	ADC_TIP_MAX_VALUE = 3800,		   // Max expected temp reading with tip inserted. Must be higher that MAX_TEMP reading. Used for tip detection
-	AC_DETECTION_INTERVAL_MS = 12	   // Max expected time between each AC interrupt
+	ADC_TIP_MAX_VALUE = 3950,		   // Max expected temp reading with tip inserted. Must be higher that MAX_TEMP reading (~3890 for type N). Used for tip detection
+	PCB_TEMP_READ_INTERVAL_MS = 1000, // Interval of the background PCB temperature (thermocouple cold junction) reads
+	STATE_TASK_PERIOD_MS = 10,		   // System state machine task rate (button, tool holder, tip state)
+	DISPLAY_TASK_PERIOD_MS = 50,	   // Display task rate, renders and sends the frame buffer
+	USB_CONSOLE_TASK_PERIOD_MS = 10,   // USB console task rate, one answer line per run
+	PCB_TEMP_MIN = -20,				   // Plausible PCB temperature range, readings outside are ignored for the cold junction compensation
+	PCB_TEMP_MAX = 100,
+	AC_DETECTION_INTERVAL_PERCENT = 120, // Max expected time between each true zero cross, % of the mains half cycle
+	AC_HALF_CYCLE_50HZ_US = 10000,	   // Duration of one AC half cycle, 50Hz mains (default until the frequency is detected)
+	AC_HALF_CYCLE_60HZ_US = 8333,	   // Duration of one AC half cycle, 60Hz mains
+	AC_FREQUENCY_DETECT_EDGES = 8,	   // Zero cross intervals in a row that must agree on the mains frequency
+	ZEROCROSS_OFFSET_US = 90,		   // Zero cross interrupt to true zero cross delay (optocoupler hysteresis), until calibrated
+	ZEROCROSS_OFFSET_MIN_US = 20,	   // Plausible calibrated offset range, zero cross pulses outside are ignored
+	ZEROCROSS_OFFSET_MAX_US = 400,
+	ZEROCROSS_OFFSET_FILTER_SHIFT = 4  // Calibration low pass, each pulse moves the offset by 1/16 of its deviation
+};
+
+enum regulator_constants {
+	PID_KP = 1100,		// Proportional gain, Q15 power per °C error (full power at ~30°C below set temp)
+	PID_KI = 550,		// Integral gain, Q15 power per °C error per 1.024s (integral time ~2s)
+	PID_KD = 110,		// Derivative gain, Q15 power per °C/1.024s tip temperature slope (derivative time ~0.1s)
+	AUTOTUNE_HYSTERESIS = 3,		// Relay hysteresis around set temp during auto-tune, °C
+	AUTOTUNE_CYCLES = 4,			// Number of oscillations averaged by the auto-tune, after the heat up oscillation
+	AUTOTUNE_TIMEOUT_MS = 120000	// Auto-tune is aborted if it takes longer than this
+};
+
+enum estimator_constants {
+	TIP_AMBIENT_TEMP = 25,				// Ambient and thermocouple cold junction temperature until the first PCB temperature reading, °C
+	ESTIMATOR_HEAT_RATE = 9175,			// C245 model: Q16 °C per ms of heater on time (~1.4°C per 50Hz half cycle)
+	ESTIMATOR_COOLING_TIME_MS = 30000,	// C245 model: first order cooling time constant of an idle tip
+	ESTIMATOR_PROCESS_NOISE = 5,		// Q10 °C² per ms, uncertainty of the thermal model (lower = trust the model more)
+	ESTIMATOR_MEASUREMENT_NOISE = 1024	// Q10 °C², variance of one averaged thermocouple reading (lower = trust the reading more)
 };
 
 enum opensolder_messages {
@@ -58,7 +106,16 @@ enum opensolder_messages {
 	ADC_READING_ERROR = 999 // Constant to check tip_temp for an error. Also displays 999 on display in case of a reading error
 };
 
-enum my_states { INIT_STATE, TIP_CHANGE_STATE, OFF_STATE, ON_STATE, STANDBY_STATE, ERROR_STATE };
+enum opensolder_events {			// event_queue types from the interrupts to the state machine
+	EVENT_BUTTON = 0,				// value: SHORT_PRESS or LONG_PRESS
+	EVENT_ENCODER,					// value: encoder steps since the last event
+	EVENT_TOOL_HOLDER,				// value: SET when the tool was placed in the holder, RESET when it was lifted
+	EVENT_TIP_CHANGER,				// value: SET when the tool touches the tip remover, RESET when it was released
+	EVENT_TIP_STATE,				// value: TIP_DETECTED, TIP_NOT_DETECTED or TIP_CHECK_ERROR, sent on change
+	EVENT_HEATER_ENERGY				// value: Q8 heater energy of the past AC half cycle, zero cross to the estimator
+};
+
+enum my_states { INIT_STATE, TIP_CHANGE_STATE, OFF_STATE, ON_STATE, STANDBY_STATE, AUTOTUNE_STATE, ERROR_STATE };
 
 /******    Global Variables    ******/
 // hardware interface
@@ -71,10 +128,13 @@ extern TIM_HandleTypeDef htim2;			// used for encoder
 extern TIM_HandleTypeDef htim6;			// used for real zero-cross delay
 extern TIM_HandleTypeDef htim7;			// used for tip temp/ presence detection (ADC) delay
 extern TIM_HandleTypeDef htim14;		// used for HID (buttons, display, stand/tip change detection)
+extern TIM_HandleTypeDef htim15;		// used to trigger the tip temperature ADC conversions
+extern TIM_HandleTypeDef htim17;		// free running 1µs timestamp for the zero cross PLL
 
 /******    Global Function Declarations    ******/
 void opensolder_init(void);
 void opensolder_main(void);
 uint8_t get_system_state(void);
+scheduler *get_scheduler(void);	// task statistics for the USB console
 
 #endif
@@ -0,0 +1,53 @@
+/*
+ * pid.h
+ *
+ * Fixed-point PID regulator for embedded systems
+ *
+ * USAGE:
+ * - Create a pid_controller object
+ * - Call pid_init() with the gains and output limits
+ * - Call pid_update() every time a new measurement is available, it returns the new output
+ * - Call pid_reset() when the regulated system was not driven by the regulator (heater off, tip change etc.)
+ *
+ * NOTES:
+ * - Output is Q15, PID_OUTPUT_MAX (32767) equals full power
+ * - Gains are integers in output units (Q15) per °C:
+ *     kp: Q15 per °C of error
+ *     ki: Q15 per °C of error per PID_TIME_BASE_MS
+ *     kd: Q15 per °C/PID_TIME_BASE_MS of measurement slope
+ * - The derivative acts on the measurement, not on the error. Setpoint changes do not kick the output
+ * - Anti-windup: the integrator is clamped to the output limits and stops integrating into saturation
+ * - No HAL dependency, the file can be compiled and tested on a host
+ */
+
+#ifndef INC_PID_H_
+#define INC_PID_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum pid_constants {
+	PID_OUTPUT_MAX = 32767,	   // Q15 full scale output
+	PID_TIME_BASE_MS = 1024,   // Time base for ki and kd, a power of two to avoid divisions
+	PID_TIME_BASE_SHIFT = 10   // log2(PID_TIME_BASE_MS)
+};
+
+typedef struct {
+	int32_t kp;
+	int32_t ki;
+	int32_t kd;
+	int32_t out_min;		// Q15 output lower limit
+	int32_t out_max;		// Q15 output upper limit
+	int32_t integrator;		// Q15 << PID_TIME_BASE_SHIFT, keeps the fractional part of small integral steps
+	int16_t prev_measurement;
+	uint8_t initialized;	// 0 until the first measurement after init/reset is received
+} pid_controller;
+
+/******    Function Declarations    ******/
+void pid_init(pid_controller *const self, int32_t kp, int32_t ki, int32_t kd, int32_t out_min, int32_t out_max);
+void pid_set_gains(pid_controller *const self, int32_t kp, int32_t ki, int32_t kd);
+void pid_reset(pid_controller *const self);
+int32_t pid_update(pid_controller *const self, int16_t setpoint, int16_t measurement, uint16_t dt_ms);
+
+#endif /* INC_PID_H_ */
@@ -0,0 +1,72 @@
+/*
+ * scheduler.h
+ *
+ * Cooperative run-to-completion task scheduler with deadlines and runtime accounting
+ *
+ * USAGE:
+ * - Create a scheduler object
+ * - Call scheduler_init() with a free running 16 bit µs clock (runtime accounting)
+ * - Call scheduler_add_task() for every task: periodic (period_ms > 0) or one-shot (period_ms = 0)
+ * - Call scheduler_run() from the main loop, sleep (WFI) when it returns RESET
+ * - scheduler_trigger() (re-)arms a task to run after delay_ms, e.g. a one-shot task or an early periodic run
+ * - scheduler_get_task() returns a task for its runtime statistics, scheduler_get_load() the busy share
+ *
+ * NOTES:
+ * - The due task with the earliest deadline runs first, one task per scheduler_run() call
+ * - Tasks run to completion and must not block, the main loop only gets back to the scheduler after them
+ * - A periodic task that missed a whole period is counted as overrun and restarts from now (no catch up runs)
+ * - A one-shot task runs once per trigger, triggering it again before it ran moves its deadline
+ * - Timestamps are ms ticks, differences are taken modulo 2^32. Runtimes above 65ms wrap the µs clock
+ * - Interrupt time during a task counts as task runtime, interrupt time while sleeping as idle
+ * - No HAL dependency, the file can be compiled and tested on a host
+ */
+
+#ifndef INC_SCHEDULER_H_
+#define INC_SCHEDULER_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum scheduler_constants {
+	SCHEDULER_MAX_TASKS = 8,
+	SCHEDULER_NO_TASK = 0xFF,		// scheduler_add_task() result if the task table is full
+	SCHEDULER_LOAD_SHIFT = 10		// scheduler_get_load() is Q10, 1024 = always busy
+};
+
+typedef void (*scheduler_task_function)(void);
+typedef uint16_t (*scheduler_clock_function)(void);
+
+typedef struct {
+	scheduler_task_function function;
+	const char *name;
+	uint32_t period_ms;			// 0 = one-shot
+	uint32_t deadline_ms;		// tick the task is due at
+	uint8_t armed;				// one-shot tasks are disarmed after their run
+	uint32_t runs;
+	uint32_t overruns;			// periodic runs that started more than one period late
+	uint64_t total_runtime_us;	// µs, 32 bit would wrap after 71 minutes of runtime
+	uint16_t max_runtime_us;
+	uint16_t max_lateness_ms;	// start after the deadline
+} scheduler_task;
+
+typedef struct {
+	scheduler_task tasks[SCHEDULER_MAX_TASKS];
+	uint8_t task_count;
+	scheduler_clock_function clock_us;
+	uint64_t busy_us;			// task runtime (µs) since the statistics were reset
+	uint32_t stats_start_ms;
+} scheduler;
+
+/******    Function Declarations    ******/
+void scheduler_init(scheduler *const self, scheduler_clock_function clock_us, uint32_t now_ms);
+uint8_t scheduler_add_task(scheduler *const self, scheduler_task_function function, const char *name, uint32_t period_ms, uint32_t first_run_ms);
+void scheduler_trigger(scheduler *const self, uint8_t task, uint32_t now_ms, uint32_t delay_ms);
+uint8_t scheduler_run(scheduler *const self, uint32_t now_ms);
+void scheduler_reset_stats(scheduler *const self, uint32_t now_ms);
+const scheduler_task *scheduler_get_task(scheduler *const self, uint8_t task);
+uint8_t scheduler_get_task_count(scheduler *const self);
+uint16_t scheduler_get_load(scheduler *const self, uint32_t now_ms);
+int scheduler_format_task(scheduler *const self, uint8_t task, char *buffer, uint16_t length);
+
+#endif /* INC_SCHEDULER_H_ */
@@ -0,0 +1,26 @@
+/*
+ * thermocouple_table.h
+ *
+ * GENERATED by tools/thermocouple_table.py, do not edit
+ *
+ * Type N thermocouple, amplifier gain 221, ADC reference 3300mV, 0°C cold junction
+ */
+
+#ifndef INC_THERMOCOUPLE_TABLE_H_
+#define INC_THERMOCOUPLE_TABLE_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum thermocouple_table_constants {
+	THERMOCOUPLE_TABLE_LENGTH = 73,
+	THERMOCOUPLE_TABLE_SEGMENT_SHIFT = 6,		// ADC counts per table segment = 1 << THERMOCOUPLE_TABLE_SEGMENT_SHIFT
+	THERMOCOUPLE_TABLE_TEMP_SHIFT = 4,			// table values are Q4 °C
+	THERMOCOUPLE_COLD_JUNCTION_SLOPE = 1882,	// Q8 ADC counts per °C cold junction temperature
+	THERMOCOUPLE_COLD_JUNCTION_SHIFT = 8
+};
+
+extern const uint16_t thermocouple_table[THERMOCOUPLE_TABLE_LENGTH];
+
+#endif /* INC_THERMOCOUPLE_TABLE_H_ */
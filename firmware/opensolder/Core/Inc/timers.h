@@ -13,17 +13,40 @@
 #include "tip_heater.h"
 #include "tip_thermocouple.h"
 #include "hid.h"
+#include "zerocross_pll.h"
+#include "isr_stats.h"
+
+enum timer_isr_stats_channels {
+	TIMER_ISR_STATS_EDGE_LATENCY = 0,		// zero cross edge (TIM14 input capture) to EXTI entry
+	TIMER_ISR_STATS_EDGE_DURATION,			// zero cross EXTI
+	TIMER_ISR_STATS_ZEROCROSS_LATENCY,		// TIM6 update event (predicted true zero cross) to ISR entry
+	TIMER_ISR_STATS_ZEROCROSS_DURATION,		// TIM6 ISR, heater switching
+	TIMER_ISR_STATS_HEATER_SWITCH_LATENCY,	// TIM6 update event (true zero cross or phase control turn off) to the heater pin write
+	TIMER_ISR_STATS_TIP_TIMER_LATENCY,		// TIM7 update event to ISR entry
+	TIMER_ISR_STATS_TIP_TIMER_DURATION,		// TIM7 ISR
+	TIMER_ISR_STATS_COUNT
+};
+
 // API
 // --- getters ---
 uint32_t get_ac_delay_tick(void);
+uint16_t get_ac_half_cycle_us(void);					// detected mains half cycle (50Hz until detected)
+uint16_t get_ac_half_cycles(uint16_t interval_ms);	// number of mains half cycles in interval_ms
+isr_stats *get_timer_isr_stats(uint8_t channel);		// timer_isr_stats_channels
+uint16_t get_timestamp_us(void);						// free running TIM17 µs timestamp
 
 // --- setters ---
 void timer_stop_zerocross_timeout(void);
-void timer_start_zerocross_timeout(void);
+void timer_start_zerocross_timeout(uint16_t zero_timestamp);
+void timer_start_phase_off_timeout(uint16_t delay_us);
 void timer_stop_tip_measure_delay(void);
 void timer_start_tip_measure_delay(void);
 
 // --- handlers ---
 void timer_init(void);
+uint8_t timer_zerocross_irq_handler(void);			// EXTI4_15 fast path, SET if handled
+uint8_t timer_zerocross_timeout_irq_handler(void);	// TIM6 fast path, SET if handled
+uint8_t timer_tip_measure_delay_irq_handler(void);	// TIM7 fast path, SET if handled
+void timer_record_heater_switch(void);				// right after the heater pin write of the TIM6 interrupt
 
 #endif /* INC_TIMERS_H_ */
@@ -11,20 +11,37 @@
 /******    Includes    ******/
 #include "opensolder.h"
 #include "timers.h"
+#include "autotune.h"
 #include "../../Drivers/tip_clamp/inc/tip_clamp.h"
 
+/******    Constants and Objects    ******/
+enum heater_modes {
+	HEATER_MODE_ZERO_CROSS = 0,	// whole half cycles on or off, switched at the true zero cross
+	HEATER_MODE_PHASE			// trailing edge phase control, every heating half cycle is turned off at a phase angle
+};
+
 // handlers
+void heater_init(void);
 void heater_control(void);	// calculates how much energy must be put into the heater cartridge
 void heater_control_timer_handler(void);
+void heater_phase_off_timer_handler(void);
 void error_handler(void);
 
 // setters
 void set_new_temp(uint16_t new_temp);
 void set_tip_heater_off(void);
+void set_heater_power_percent(uint8_t percent);	// share of heating half cycles switched on, overwritten by the regulator in ON_STATE
 void set_tip_error_halt(void);
+void heater_start_autotune(void);	// relay auto-tune around set_temp, new PID gains are applied when done
+void heater_stop_autotune(void);
+void set_heater_mode(uint8_t mode);	// heater_modes, takes effect with the next heating half cycle
 
 // getters
 uint16_t get_set_temp(void);
-uint8_t get_power_bar_value(void);
+uint8_t get_heater_power_percent(void);	// current power demand, 0-100%
+uint8_t get_heater_duty_percent(void);	// share of AC half cycles the heater was on, measurement half cycles included
+uint16_t get_measurement_rate_hz(void);	// tip temperature readings per second
+uint8_t get_autotune_state(void);	// autotune_states from autotune.h
+uint8_t get_heater_mode(void);
 
 #endif /* INC_TIP_HEATER_H_ */
@@ -14,6 +14,8 @@
 #include "../../Drivers/tip_check/inc/tip_check.h"
 #include "../../Drivers/tip_clamp/inc/tip_clamp.h"
 #include "tip_heater.h"
+#include "isr_stats.h"
+#include "event_queue.h"
 
 /******    Global Function Declarations    ******/
 
@@ -25,12 +27,24 @@ enum adc_states {
 };
 
 // handlers
+void tip_thermocouple_init(void);
 void tip_check_counter_increase(void);	// called every zero cross
+void tip_temp_estimator_predict(uint16_t heater_energy);	// called every AC half cycle with the heater energy (Q8 share of ESTIMATOR_HEATER_ON) of the past half cycle
 void tip_timer_handler(void);
+uint8_t tip_adc_dma_irq_handler(void);	// DMA1 channel 1 fast path, SET if handled
+void tip_regulator_pendsv_handler(void);	// estimator predictions, estimator update and heater_control() of a new reading
+
+// setters
+void set_cold_junction_temp(int16_t temp);	// °C, from the PCB temperature sensor
 
 // getters
 uint8_t tip_check(void);
-uint16_t get_tip_temp(void);
+uint16_t get_tip_temp(void);			// last thermocouple reading
+uint16_t get_tip_temp_estimate(void);	// model based estimate, updated every AC half cycle
+uint8_t get_tip_temp_estimate_valid(void);	// RESET until the first valid reading
 uint8_t get_tip_state(void);
+event_queue *get_tip_events(void);		// EVENT_TIP_STATE, consumed by the state machine
+event_queue *get_estimator_events(void);	// EVENT_HEATER_ENERGY, consumed by the estimator in PendSV
+isr_stats *get_adc_isr_stats(void);		// duration of the ADC DMA interrupt
 
 #endif
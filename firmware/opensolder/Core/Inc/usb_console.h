@@ -0,0 +1,28 @@
+/*
+ * usb_console.h
+ *
+ * Text commands over the USB CDC (virtual COM) port
+ *
+ * Commands (terminated by CR or LF):
+ * - "isr"			print the interrupt latency and duration statistics (µs, see isr_stats.h)
+ *					and the events dropped by the full hid and tip event queues
+ * - "isr reset"	clear the interrupt statistics
+ * - "tasks"		print the runtime statistics of the main loop tasks (see scheduler.h) and the CPU load
+ * - "tasks reset"	clear the task statistics
+ */
+
+#ifndef INC_USB_CONSOLE_H_
+#define INC_USB_CONSOLE_H_
+
+#include "opensolder.h"
+
+enum usb_console_constants {
+	USB_CONSOLE_LINE_LENGTH = 32,	// longest command
+	USB_CONSOLE_TX_LENGTH = 128		// longest output line
+};
+
+// --- handlers ---
+void usb_console__receive(const uint8_t *buffer, uint32_t length);	// called from the CDC receive callback (USB interrupt)
+void usb_console__poll(void);	// USB_CONSOLE_TASK_PERIOD_MS task, sends the answers one line per call
+
+#endif /* INC_USB_CONSOLE_H_ */
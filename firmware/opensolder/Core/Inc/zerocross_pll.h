@@ -0,0 +1,67 @@
+/*
+ * zerocross_pll.h
+ *
+ * Software phase-locked loop tracking the mains zero crossings from the optocoupler edges
+ *
+ * USAGE:
+ * - Create a zerocross_pll object
+ * - Call zerocross_pll_init() with the nominal half cycle and the edge to true zero cross offset
+ * - Call zerocross_pll_edge() with the timestamp of every zero cross edge
+ * - Call zerocross_pll_coast() when a predicted zero cross passed without an edge
+ * - zerocross_pll_get_next_zero() returns the timestamp of the next true zero cross
+ * - zerocross_pll_set_offset() updates the edge to true zero cross offset (calibration)
+ *
+ * NOTES:
+ * - Timestamps are from a free running 16 bit µs timer, differences are taken modulo 2^16
+ * - Until ZEROCROSS_PLL_LOCK_EDGES plausible edges were seen, the PLL follows the raw edges
+ * - Locked, edges outside ZEROCROSS_PLL_WINDOW_US of the prediction are rejected as noise,
+ *   accepted edges correct the phase and the period by a fraction of the error
+ * - Up to ZEROCROSS_PLL_MAX_COAST missing edges in a row are bridged with the predicted period
+ * - No HAL dependency, the file can be compiled and tested on a host
+ */
+
+#ifndef INC_ZEROCROSS_PLL_H_
+#define INC_ZEROCROSS_PLL_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum zerocross_pll_constants {
+	ZEROCROSS_PLL_LOCK_EDGES = 4,		// plausible edges in a row before the PLL locks
+	ZEROCROSS_PLL_MAX_COAST = 4,		// missing edges in a row before the PLL loses lock
+	ZEROCROSS_PLL_WINDOW_US = 1000,		// accepted deviation of an edge from the prediction
+	ZEROCROSS_PLL_TOLERANCE = 10,		// accepted period deviation from the nominal half cycle, %
+	ZEROCROSS_PLL_PHASE_SHIFT = 2,		// phase correction = error / 4
+	ZEROCROSS_PLL_PERIOD_SHIFT = 4,		// period correction = error / 16
+	ZEROCROSS_PLL_PERIOD_Q = 8			// period is Q8 µs
+};
+
+enum zerocross_pll_results {
+	ZEROCROSS_PLL_REJECTED = 0,	// edge is noise, ignore it
+	ZEROCROSS_PLL_ACCEPTED,		// edge belongs to the upcoming zero cross
+	ZEROCROSS_PLL_LATE			// edge belongs to the zero cross that was already coasted through
+};
+
+typedef struct {
+	uint32_t nominal_period;	// Q8 µs
+	uint32_t period;			// Q8 µs, tracked half cycle duration
+	uint16_t offset_us;			// optocoupler edge to true zero cross
+	uint16_t last_edge;			// timestamp of the last (filtered or coasted) edge
+	uint16_t last_raw_edge;		// timestamp of the last accepted edge as measured
+	uint8_t locked;
+	uint8_t lock_count;			// plausible edges in a row during acquisition
+	uint8_t coast_count;		// missing edges in a row
+} zerocross_pll;
+
+/******    Function Declarations    ******/
+void zerocross_pll_init(zerocross_pll *const self, uint16_t nominal_period_us, uint16_t offset_us);
+uint8_t zerocross_pll_edge(zerocross_pll *const self, uint16_t timestamp);
+uint8_t zerocross_pll_coast(zerocross_pll *const self);
+uint16_t zerocross_pll_get_zero(zerocross_pll *const self);
+uint16_t zerocross_pll_get_next_zero(zerocross_pll *const self);
+uint16_t zerocross_pll_get_period(zerocross_pll *const self);
+void zerocross_pll_set_offset(zerocross_pll *const self, uint16_t offset_us);
+uint8_t zerocross_pll_is_locked(zerocross_pll *const self);
+
+#endif /* INC_ZEROCROSS_PLL_H_ */
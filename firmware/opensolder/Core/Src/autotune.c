@@ -0,0 +1,115 @@
+/*
+ * autotune.c
+ *
+ * Relay feedback (Åström-Hägglund) auto-tuner for the fixed-point PID regulator
+ *
+ * The relay forces the process into a limit cycle around the setpoint. From the
+ * oscillation period Tu and peak to peak amplitude A, the ultimate gain is
+ * Ku = 4 * d / (pi * A / 2), where d is half the relay output swing.
+ * The PID gains are derived with the Pessen "some overshoot" rule:
+ * Kp = 0.33 * Ku, Ti = Tu / 2, Td = Tu / 3
+ */
+
+#include "autotune.h"
+#include "pid.h"
+
+/******    Local Function Declarations    ******/
+static void autotune_calculate_gains(autotune *const self);
+
+/******    functions    ******/
+void autotune_start(autotune *const self, int16_t setpoint, int16_t hysteresis, int32_t output_low, int32_t output_high, uint8_t cycles, uint32_t timeout_ms) {
+	self->setpoint = setpoint;
+	self->hysteresis = hysteresis;
+	self->output_low = output_low;
+	self->output_high = output_high;
+	self->cycles_target = cycles;
+	self->timeout_ms = timeout_ms;
+
+	self->relay_on = 1;
+	self->cycles = 0;
+	self->cycle_started = 0;
+	self->peak_max = INT16_MIN;
+	self->peak_min = INT16_MAX;
+	self->cycle_time_ms = 0;
+	self->elapsed_ms = 0;
+	self->period_sum_ms = 0;
+	self->amplitude_sum = 0;
+	self->kp = 0;
+	self->ki = 0;
+	self->kd = 0;
+	self->state = AUTOTUNE_RUNNING;
+}
+
+void autotune_stop(autotune *const self) {
+	self->state = AUTOTUNE_IDLE;
+}
+
+int32_t autotune_update(autotune *const self, int16_t measurement, uint16_t dt_ms) {
+	if (self->state != AUTOTUNE_RUNNING) {
+		return self->output_low;
+	}
+
+	self->elapsed_ms += dt_ms;
+	self->cycle_time_ms += dt_ms;
+	if (self->elapsed_ms > self->timeout_ms) {
+		self->state = AUTOTUNE_FAILED;
+		return self->output_low;
+	}
+
+	if (measurement > self->peak_max) {
+		self->peak_max = measurement;
+	}
+	if (measurement < self->peak_min) {
+		self->peak_min = measurement;
+	}
+
+	if (self->relay_on && (measurement > (self->setpoint + self->hysteresis))) {
+		self->relay_on = 0;
+	} else if (!self->relay_on && (measurement < (self->setpoint - self->hysteresis))) {
+		// Relay switch-on marks the start of a new oscillation
+		self->relay_on = 1;
+		if (self->cycle_started) {
+			self->period_sum_ms += self->cycle_time_ms;
+			self->amplitude_sum += self->peak_max - self->peak_min;
+			self->cycles++;
+		}
+		self->cycle_started = 1;
+		self->cycle_time_ms = 0;
+		self->peak_max = measurement;
+		self->peak_min = measurement;
+
+		if (self->cycles >= self->cycles_target) {
+			autotune_calculate_gains(self);
+			return self->output_low;
+		}
+	}
+
+	return self->relay_on ? self->output_high : self->output_low;
+}
+
+uint8_t autotune_get_state(autotune *const self) {
+	return self->state;
+}
+
+void autotune_get_gains(autotune *const self, int32_t *kp, int32_t *ki, int32_t *kd) {
+	*kp = self->kp;
+	*ki = self->ki;
+	*kd = self->kd;
+}
+
+static void autotune_calculate_gains(autotune *const self) {
+	if ((self->amplitude_sum == 0) || (self->period_sum_ms == 0)) {
+		self->state = AUTOTUNE_FAILED;
+		return;
+	}
+
+	// Ku = 8 * d / (pi * A), pi = 3142 / 1000. Q15 output per °C
+	int32_t relay_amplitude = (self->output_high - self->output_low) / 2;
+	int32_t ku = ((8000 * relay_amplitude) / 3142) * self->cycles / (int32_t)self->amplitude_sum;
+	int32_t tu_ms = self->period_sum_ms / self->cycles;
+
+	self->kp = (ku * 33) / 100;
+	self->ki = (self->kp * 2 * PID_TIME_BASE_MS) / tu_ms;	// kp / Ti, Ti = Tu / 2
+	self->kd = (self->kp * tu_ms) / (3 * PID_TIME_BASE_MS);	// kp * Td, Td = Tu / 3
+	self->state = AUTOTUNE_DONE;
+}
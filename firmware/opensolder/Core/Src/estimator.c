@@ -0,0 +1,71 @@
+/*
+ * estimator.c
+ *
+ * Fixed-point scalar Kalman filter estimating the tip temperature between thermocouple readings
+ */
+
+#include "estimator.h"
+
+/******    functions    ******/
+void estimator_init(estimator *const self, int32_t heat_rate, uint32_t cooling_time_ms, uint32_t process_noise, uint32_t measurement_noise, int16_t ambient) {
+	self->heat_rate = heat_rate;
+	self->cooling_time_ms = cooling_time_ms;
+	self->process_noise = process_noise;
+	self->measurement_noise = measurement_noise;
+	self->ambient = ambient;
+	estimator_reset(self);
+}
+
+void estimator_reset(estimator *const self) {
+	self->temperature = 0;
+	self->variance = ESTIMATOR_VARIANCE_MAX;
+	self->initialized = 0;
+}
+
+void estimator_set_ambient(estimator *const self, int16_t ambient) {
+	self->ambient = ambient;
+}
+
+void estimator_predict(estimator *const self, uint16_t heater_energy, uint16_t dt_ms) {
+	if (!self->initialized) {
+		return;
+	}
+
+	// Model step: heater energy in, newton cooling out
+	int32_t excess_temperature = self->temperature - ((int32_t)self->ambient << 16);
+	self->temperature -= (excess_temperature * dt_ms) / (int32_t)self->cooling_time_ms;
+	self->temperature += (self->heat_rate * dt_ms * (int32_t)heater_energy) >> ESTIMATOR_HEATER_SHIFT;
+
+	// The model is not exact, so the uncertainty grows until the next reading
+	self->variance += self->process_noise * dt_ms;
+	if (self->variance > ESTIMATOR_VARIANCE_MAX) {
+		self->variance = ESTIMATOR_VARIANCE_MAX;
+	}
+}
+
+void estimator_update(estimator *const self, int16_t measurement) {
+	int32_t innovation = ((int32_t)measurement << 16) - self->temperature;
+
+	if (!self->initialized || (innovation > (ESTIMATOR_GATE_TEMP << 16)) || (innovation < -(ESTIMATOR_GATE_TEMP << 16))) {
+		// No usable prior, start from the reading
+		self->temperature = (int32_t)measurement << 16;
+		self->variance = self->measurement_noise;
+		self->initialized = 1;
+		return;
+	}
+
+	// Kalman gain K = P / (P + R), Q15. P <= ESTIMATOR_VARIANCE_MAX keeps P << 15 within 32 bit
+	uint32_t gain = (self->variance << 15) / (self->variance + self->measurement_noise);
+
+	// innovation is limited to the gate, (Q8 innovation * Q15 gain) >> 7 = Q16 correction
+	self->temperature += ((innovation >> 8) * (int32_t)gain) >> 7;
+	self->variance -= (self->variance * gain) >> 15;
+}
+
+int16_t estimator_get_temperature(estimator *const self) {
+	return (self->temperature + (1 << 15)) >> 16;
+}
+
+uint8_t estimator_is_initialized(estimator *const self) {
+	return self->initialized;
+}
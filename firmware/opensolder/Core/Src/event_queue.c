@@ -0,0 +1,45 @@
+/*
+ * event_queue.c
+ *
+ * Lock-free single producer, single consumer ring buffer of typed events from an interrupt to the main loop
+ */
+
+#include "event_queue.h"
+#include <stdatomic.h>
+
+/******    functions    ******/
+void event_queue_init(event_queue *const self) {
+	self->head = 0;
+	self->tail = 0;
+	self->dropped = 0;
+}
+
+uint8_t event_queue_push(event_queue *const self, uint8_t type, int16_t value) {
+	uint8_t head = self->head;
+	uint8_t next = (head + 1) & (EVENT_QUEUE_LENGTH - 1);
+	if (next == self->tail) {
+		self->dropped++;
+		return 0;
+	}
+	self->events[head].type = type;
+	self->events[head].value = value;
+	atomic_signal_fence(memory_order_release);	// the event is complete before the consumer can see it
+	self->head = next;
+	return 1;
+}
+
+uint8_t event_queue_pop(event_queue *const self, event *const result) {
+	uint8_t tail = self->tail;
+	if (tail == self->head) {
+		return 0;
+	}
+	atomic_signal_fence(memory_order_acquire);	// read the event only after head was seen
+	*result = self->events[tail];
+	atomic_signal_fence(memory_order_release);	// the slot is read before the producer can reuse it
+	self->tail = (tail + 1) & (EVENT_QUEUE_LENGTH - 1);
+	return 1;
+}
+
+uint16_t event_queue_get_dropped(event_queue *const self) {
+	return self->dropped;
+}
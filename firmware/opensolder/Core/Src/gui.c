@@ -16,18 +16,62 @@
 #include "../../Drivers/pcb_temperature/inc/pcb_temperature.h"
 
 /******    Struct Declaration    ******/
+// Retained widgets: each one remembers what it shows on the display and is only drawn again when that changes.
+// Setting a value doesn't draw, the render functions do. The ssd1306 driver marks the bytes a render changes
+// as dirty, so ssd1306_UpdateScreen() only sends the damaged parts. Clearing the screen invalidates its widgets
 typedef struct {
 	uint8_t x;							   // Upper left x starting position of string
 	uint8_t y;							   // Upper left y starting position of string
 	FontDef *font;						   // Font type (Font_7x10 etc.)
 	SSD1306_COLOR color;				   // Font color [Black, White]
 	char string[STR_ARRAY_MAX_LEN]; // Currently fixed value, no need for malloc()
-	uint8_t length;						   // Max number of characters. If strlen(string) is shorter than length, blank characters are appended to string
-} ssd1306_string;
+	uint8_t length;						   // Max number of characters. If strlen(string) is shorter than length, blank characters are drawn after it
+	uint8_t valid;						   // string is on the display
+} gui_label;
+
+typedef struct {
+	gui_label label;
+	const char *format;	// printf format of the value
+	int32_t value;		// value in label.string, INT32_MIN before the first one
+} gui_numeric;
+
+typedef struct {
+	uint8_t x1;			// fill area, the frame is a gui_rectangle
+	uint8_t y1;
+	uint8_t x2;
+	uint8_t y2;
+	uint8_t end;		// last filled column, x1 - 1 = empty
+	uint8_t drawn_end;	// end on the display
+	uint8_t valid;		// drawn_end is on the display
+} gui_bar;
+
+typedef struct {
+	uint8_t x1;
+	uint8_t y1;
+	uint8_t x2;
+	uint8_t y2;
+	SSD1306_COLOR color;
+	uint8_t valid;
+} gui_rectangle;
+
+enum gui_screens {
+	SCREEN_NONE,
+	SCREEN_SPLASH,
+	SCREEN_DEFAULT,
+	SCREEN_MESSAGE
+};
 
 /******    Local Function Declarations    ******/
 static void draw_init_display(void);
-static void write_string(ssd1306_string string);
+static void show_screen(uint8_t screen);
+static void set_label(gui_label *const label, const char *string);
+static void set_numeric(gui_numeric *const numeric, int32_t value);
+static void set_numeric_text(gui_numeric *const numeric, const char *string);
+static void set_bar_percent(gui_bar *const bar, uint8_t percent);
+static void render_label(gui_label *const label);
+static uint8_t render_bar(gui_bar *const bar);
+static void render_rectangle(gui_rectangle *const rectangle);
+static void render_default_display(void);
 
 /******    File Scope Variables    ******/
 enum display_constants {
@@ -92,149 +136,274 @@ enum display_constants {
 	MSG_TEXT_MAX_LEN = (DISPLAY_WIDTH - 4 * MSG_OFFSET - 2) / 7,
 };
 
-static ssd1306_string s_opensolder = {INIT_TEXT_X, INIT_TEXT_Y, &Font_11x18, White, "OpenSolder\0", 10};
-static ssd1306_string s_firmware = {INIT_TEXT_X, INIT_R_Y2 + TEXT_OFFSET + 2, &Font_7x10, White, "Firmware:   v0.9\0", 16};
-static ssd1306_string s_ambient = {INIT_TEXT_X, INIT_R_Y2 + TEXT_OFFSET * 2 + 10, &Font_7x10, White, "Ambient:    \0", 16};
+static uint8_t active_screen = SCREEN_NONE;
+
+static gui_rectangle init_frame = {INIT_R_X1, INIT_R_Y1, INIT_R_X2, INIT_R_Y2, White, 0};
+static gui_label s_opensolder = {INIT_TEXT_X, INIT_TEXT_Y, &Font_11x18, White, "OpenSolder", 10, 0};
+static gui_label s_firmware = {INIT_TEXT_X, INIT_R_Y2 + TEXT_OFFSET + 2, &Font_7x10, White, "Firmware:   v0.9", 16, 0};
+static gui_label s_ambient = {INIT_TEXT_X, INIT_R_Y2 + TEXT_OFFSET * 2 + 10, &Font_7x10, White, "Ambient:    ", 16, 0};
 
-static ssd1306_string set_temp_text = {SET_TEXT_X, SET_TEXT_Y, &Font_7x10, White, "Set\0", 3};
-static ssd1306_string set_temp_val = {SET_VAL_X, SET_VAL_Y, &Font_11x18, White, "300'\0", 4};
-static ssd1306_string tip_temp_text = {TIP_TEXT_X, TIP_TEXT_Y, &Font_7x10, White, "Tip\0", 3};
-static ssd1306_string tip_temp_val = {TIP_VAL_X, TIP_VAL_Y, &Font_11x18, White, "302'\0", 4};
+static gui_rectangle set_temp_frame = {SET_R_X1, SET_R_Y1, SET_R_X2, SET_R_Y2, White, 0};
+static gui_label set_temp_text = {SET_TEXT_X, SET_TEXT_Y, &Font_7x10, White, "Set", 3, 0};
+static gui_numeric set_temp_val = {{SET_VAL_X, SET_VAL_Y, &Font_11x18, White, "300'", 4, 0}, "%d'C", INT32_MIN};
+static gui_rectangle tip_temp_frame = {TIP_R_X1, TIP_R_Y1, TIP_R_X2, TIP_R_Y2, White, 0};
+static gui_label tip_temp_text = {TIP_TEXT_X, TIP_TEXT_Y, &Font_7x10, White, "Tip", 3, 0};
+static gui_numeric tip_temp_val = {{TIP_VAL_X, TIP_VAL_Y, &Font_11x18, White, "302'", 4, 0}, "%d'C", INT32_MIN};
 
-static ssd1306_string power_bar_text = {PB_TEXT_X, PB_TEXT_Y, &Font_6x8, White, "\0", PB_TEXT_MAX_LEN};
-static ssd1306_string message_text = {MSG_TEXT_X, MSG_TEXT_Y, &Font_7x10, White, "\0", MSG_TEXT_MAX_LEN};
+static gui_rectangle power_bar_frame = {PB_R_X1, PB_R_Y1, PB_R_X2, PB_R_Y2, White, 0};
+static gui_bar power_bar = {PB_R_X1 + 1, PB_R_Y1 + 1, PB_R_X2 - 1, PB_R_Y2 - 1, PB_R_X1, PB_R_X1, 0};
+static gui_label power_bar_text = {PB_TEXT_X, PB_TEXT_Y, &Font_6x8, White, "", PB_TEXT_MAX_LEN, 0};
+
+static gui_rectangle message_frame = {MSG_R_X1, MSG_R_Y1, MSG_R_X2, MSG_R_Y2, White, 0};
+static gui_label message_text = {MSG_TEXT_X, MSG_TEXT_Y, &Font_7x10, White, "", MSG_TEXT_MAX_LEN, 0};
 
 /******    Functions    ******/
 // Draw the default display image
-void init_display(uint16_t timeout) {
+// The splash screen stays until the state machine task draws the first screen (started SPLASHSCREEN_TIMEOUT_MS later)
+void init_display(void) {
 	ssd1306_Init();
 	ssd1306_SetContrast(DISPLAY_BRIGHTNESS);
 	draw_init_display();
-	HAL_Delay(timeout);
 }
 
 // Draw the splash screen during initialization
 void draw_init_display(void) {
-	ssd1306_Fill(Black);
-	ssd1306_DrawRectangle(INIT_R_X1, INIT_R_Y1, INIT_R_X2, INIT_R_Y2, White);
-	write_string(s_opensolder);
+	show_screen(SCREEN_SPLASH);
 
-	// Read ambient temperature and concaternate to s_ambient.string
+	// Read ambient temperature and append it to the ambient label
 	char s_buffer[STR_ARRAY_MAX_LEN];
-	snprintf(s_buffer, sizeof(s_buffer), "%d'C", pcb_temperature_driver__get_temperature());
-	strcat(s_ambient.string, s_buffer);
+	snprintf(s_buffer, sizeof(s_buffer), "%s%d'C", s_ambient.string, pcb_temperature_driver__get_temperature());
+	set_label(&s_ambient, s_buffer);
 
-	write_string(s_firmware);
-	write_string(s_ambient);
+	render_rectangle(&init_frame);
+	render_label(&s_opensolder);
+	render_label(&s_firmware);
+	render_label(&s_ambient);
 	ssd1306_UpdateScreen();
 }
 
-void write_string(ssd1306_string string) {
-	// Pad string.string if shorter than string.length to clear previous characters
-	ssd1306_SetCursor(string.x, string.y);
-	if (strlen(string.string) < string.length) {
-		for (uint8_t i = strlen(string.string); i < string.length; i++) {
-			strcat(string.string, " ");
-		}
-	} else if (strlen(string.string) > string.length) {
-		string.string[string.length] = '\0';
-	}
-
-	// Write new string
-	ssd1306_SetCursor(string.x, string.y);
-	ssd1306_WriteString(string.string, *string.font, string.color);
-}
-
 void draw_default_display(void) {
-	ssd1306_Fill(Black);
-	ssd1306_DrawRectangle(SET_R_X1, SET_R_Y1, SET_R_X2, SET_R_Y2, White);
-	ssd1306_DrawRectangle(TIP_R_X1, TIP_R_Y1, TIP_R_X2, TIP_R_Y2, White);
-	ssd1306_DrawRectangle(PB_R_X1, PB_R_Y1, PB_R_X2, PB_R_Y2, White);
-	write_string(set_temp_text);
-	write_string(set_temp_val);
-	write_string(tip_temp_text);
-	write_string(tip_temp_val);
+	show_screen(SCREEN_DEFAULT);
+	render_default_display();
 	ssd1306_UpdateScreen();
 }
 
 void update_display(void) {
 	static uint32_t display_update_tick = 0;
 	static uint16_t prev_tip_temp = 0;
-	static uint16_t power_bar_value = 0;
 
-	// Update set_temp
-	snprintf(set_temp_val.string, set_temp_val.length + 1, "%d'C", get_set_temp());
-	write_string(set_temp_val);
+	show_screen(SCREEN_DEFAULT);
 
-	// Keep rapid changing elements like tip_temp from creating display jitter
-	if ((HAL_GetTick() > display_update_tick)
-			|| (get_tip_temp() < prev_tip_temp - 1)
-			|| (get_tip_temp() > prev_tip_temp + 1)) {
-		display_update_tick = HAL_GetTick() + DISPLAY_UPDATE_TICKS;
-		prev_tip_temp = get_tip_temp();
+	// Update set_temp, formatted and drawn only when it changed
+	set_numeric(&set_temp_val, get_set_temp());
 
-		snprintf(tip_temp_val.string, tip_temp_val.length + 1, "%d'C", get_tip_temp());
-		write_string(tip_temp_val);
+	// The estimate is shown, but a reading error shows ADC_READING_ERROR (999) as the reading did. The estimator
+	// is not updated on errors, it would freeze or show its model cool down. No estimate before the first reading
+	uint16_t tip_temp = get_tip_temp_estimate();
+	if (get_tip_temp() == ADC_READING_ERROR) {
+		tip_temp = ADC_READING_ERROR;
+	}
 
-		// Clear powerbar
-		ssd1306_DrawFilledRectangle(PB_R_X1 + 1, PB_R_Y1 + 1, PB_R_X2 - 1, PB_R_Y2 - 1, Black);
+	// Keep rapid changing elements like tip_temp from creating display jitter
+	if ((get_tip_temp_estimate_valid() == RESET) && (tip_temp != ADC_READING_ERROR)) {
+		set_numeric_text(&tip_temp_val, "---'");
+		set_bar_percent(&power_bar, get_heater_power_percent());
+	} else if ((HAL_GetTick() > display_update_tick)
+			|| (tip_temp < prev_tip_temp - 1)
+			|| (tip_temp > prev_tip_temp + 1)) {
+		display_update_tick = HAL_GetTick() + DISPLAY_UPDATE_TICKS;
+		prev_tip_temp = tip_temp;
 
-		// Draw powerbar
-		power_bar_value = (uint16_t)get_power_bar_value() * (PB_R_X2 - PB_R_X1 - 1) / MAX_ON_PERIODS + PB_R_X1;
-		ssd1306_DrawFilledRectangle(PB_R_X1, PB_R_Y1 + 1, power_bar_value, PB_R_Y2 - 1, White);
+		set_numeric(&tip_temp_val, tip_temp);
+		set_bar_percent(&power_bar, get_heater_power_percent());
 	}
 
 	// DEBUG - display current state
+	char s_buffer[STR_ARRAY_MAX_LEN];
 	switch (get_system_state()) {
 		case INIT_STATE:
-			snprintf(power_bar_text.string, power_bar_text.length + 1, "Initial");
+			set_label(&power_bar_text, "Initial");
 			break;
 		case TIP_CHANGE_STATE:
-			snprintf(power_bar_text.string, power_bar_text.length + 1, "Tip change");
+			set_label(&power_bar_text, "Tip change");
 			break;
 		case OFF_STATE:
-			snprintf(power_bar_text.string, power_bar_text.length + 1, "OFF state");
+			set_label(&power_bar_text, "OFF state");
 			break;
 		case ON_STATE:
-			snprintf(power_bar_text.string, power_bar_text.length + 1, "ON state");
+			snprintf(s_buffer, sizeof(s_buffer), "%s %d%% %dHz", (get_heater_mode() == HEATER_MODE_PHASE) ? "PH" : "ON",
+					get_heater_duty_percent(), get_measurement_rate_hz());
+			set_label(&power_bar_text, s_buffer);
 			break;
 		case STANDBY_STATE:
-			snprintf(power_bar_text.string, power_bar_text.length + 1, "Standby");
+			set_label(&power_bar_text, "Standby");
+			break;
+		case AUTOTUNE_STATE:
+			set_label(&power_bar_text, "Auto-tune");
 			break;
 		case ERROR_STATE:
-			snprintf(power_bar_text.string, power_bar_text.length + 1, "Error");
+			set_label(&power_bar_text, "Error");
 			break;
 		default:
 			break;
 	}
-	write_string(power_bar_text);
 	// DEBUG END - display current state
 
-	// Update the display with the new values
+	// Draw the changed widgets and send the damaged parts of the display
+	render_default_display();
+	ssd1306_UpdateScreen();
+}
+
+// Sends screen changes that were held back by a display transfer still running at the last update
+void flush_display(void) {
 	ssd1306_UpdateScreen();
 }
 
 void display_message(uint16_t message_code) {
 	switch (message_code) {
 		case TIP_NOT_DETECTED:
-			snprintf(message_text.string, message_text.length + 1, "Insert tip");
+			set_label(&message_text, "Insert tip");
 			break;
 		case TIP_CHECK_ERROR:
-			snprintf(message_text.string, message_text.length + 1, "Tip check error");
+			set_label(&message_text, "Tip check error");
 			break;
 		case AC_NOT_DETECTED:
-			snprintf(message_text.string, message_text.length + 1, "AC not detected");
+			set_label(&message_text, "AC not detected");
 			break;
 		case OVERHEATING:
-			snprintf(message_text.string, message_text.length + 1, "! Overheating !");
+			set_label(&message_text, "! Overheating !");
 			break;
 		default:
-			snprintf(message_text.string, message_text.length + 1, "Unknown error");
+			set_label(&message_text, "Unknown error");
 			break;
 	}
 
-	ssd1306_Fill(Black);
-	ssd1306_DrawRectangle(MSG_R_X1, MSG_R_Y1, MSG_R_X2, MSG_R_Y2, White);
-	write_string(message_text);
+	show_screen(SCREEN_MESSAGE);
+	render_rectangle(&message_frame);
+	render_label(&message_text);
 	ssd1306_UpdateScreen();
 }
+
+// Clears the display for another screen, the widgets of that screen are drawn completely on their next render
+static void show_screen(uint8_t screen) {
+	if (screen == active_screen) {
+		return;
+	}
+	active_screen = screen;
+	ssd1306_Fill(Black);
+
+	switch (screen) {
+		case SCREEN_SPLASH:
+			init_frame.valid = 0;
+			s_opensolder.valid = 0;
+			s_firmware.valid = 0;
+			s_ambient.valid = 0;
+			break;
+		case SCREEN_DEFAULT:
+			set_temp_frame.valid = 0;
+			set_temp_text.valid = 0;
+			set_temp_val.label.valid = 0;
+			tip_temp_frame.valid = 0;
+			tip_temp_text.valid = 0;
+			tip_temp_val.label.valid = 0;
+			power_bar_frame.valid = 0;
+			power_bar.valid = 0;
+			power_bar_text.valid = 0;
+			break;
+		case SCREEN_MESSAGE:
+			message_frame.valid = 0;
+			message_text.valid = 0;
+			break;
+		default:
+			break;
+	}
+}
+
+static void render_default_display(void) {
+	render_rectangle(&set_temp_frame);
+	render_rectangle(&tip_temp_frame);
+	render_rectangle(&power_bar_frame);
+	render_label(&set_temp_text);
+	render_label(&set_temp_val.label);
+	render_label(&tip_temp_text);
+	render_label(&tip_temp_val.label);
+
+	// The state text is drawn over the power bar
+	if (render_bar(&power_bar)) {
+		power_bar_text.valid = 0;
+	}
+	render_label(&power_bar_text);
+}
+
+// Takes string, cut to the label length. Only a different string invalidates the label
+static void set_label(gui_label *const label, const char *string) {
+	if (strncmp(label->string, string, label->length) != 0) {
+		strncpy(label->string, string, label->length);
+		label->string[label->length] = '\0';
+		label->valid = 0;
+	}
+}
+
+// Formats the value only if it changed
+static void set_numeric(gui_numeric *const numeric, int32_t value) {
+	if (value == numeric->value) {
+		return;
+	}
+	numeric->value = value;
+	snprintf(numeric->label.string, numeric->label.length + 1, numeric->format, (int)value);
+	numeric->label.valid = 0;
+}
+
+// Text instead of a value (no reading yet etc.), the next value is formatted again
+static void set_numeric_text(gui_numeric *const numeric, const char *string) {
+	numeric->value = INT32_MIN;
+	set_label(&numeric->label, string);
+}
+
+static void set_bar_percent(gui_bar *const bar, uint8_t percent) {
+	if (percent > 100) {
+		percent = 100;
+	}
+	bar->end = bar->x1 - 1 + (uint16_t)percent * (bar->x2 - bar->x1 + 1) / 100;
+}
+
+// Draws the label if it changed, blank characters clear the rest of a longer previous string
+static void render_label(gui_label *const label) {
+	if (label->valid) {
+		return;
+	}
+	ssd1306_SetCursor(label->x, label->y);
+	ssd1306_WriteString(label->string, *label->font, label->color);
+	for (uint8_t i = strlen(label->string); i < label->length; i++) {
+		ssd1306_WriteChar(' ', *label->font, label->color);
+	}
+	label->valid = 1;
+}
+
+// Draws only the columns between the displayed and the new end of the bar, returns 1 if it drew
+static uint8_t render_bar(gui_bar *const bar) {
+	if (!bar->valid) {
+		if (bar->end >= bar->x1) {
+			ssd1306_DrawFilledRectangle(bar->x1, bar->y1, bar->end, bar->y2, White);
+		}
+		if (bar->end < bar->x2) {
+			ssd1306_DrawFilledRectangle(bar->end + 1, bar->y1, bar->x2, bar->y2, Black);
+		}
+	} else if (bar->end > bar->drawn_end) {
+		ssd1306_DrawFilledRectangle(bar->drawn_end + 1, bar->y1, bar->end, bar->y2, White);
+	} else if (bar->end < bar->drawn_end) {
+		ssd1306_DrawFilledRectangle(bar->end + 1, bar->y1, bar->drawn_end, bar->y2, Black);
+	} else {
+		return 0;
+	}
+	bar->drawn_end = bar->end;
+	bar->valid = 1;
+	return 1;
+}
+
+static void render_rectangle(gui_rectangle *const rectangle) {
+	if (!rectangle->valid) {
+		ssd1306_DrawRectangle(rectangle->x1, rectangle->y1, rectangle->x2, rectangle->y2, rectangle->color);
+		rectangle->valid = 1;
+	}
+}
@@ -9,18 +9,21 @@
 
 #include "button.h"
 #include "encoder.h"
+#include "event_queue.h"
 
 static button tool_holder_sensor; 	// Detects when tool is placed in holder
 static button tip_change_sensor; 	// Detects when tool touches the tip change bracket
 static button mmi_button;		  	// Front rotary encoder button
 static encoder mmi_encoder;		  	// Front rotary encoder
-static uint8_t mmi_button_event;
 static uint8_t mmi_encoder_event;
+static int16_t mmi_encoder_delta;	// rotation not sent yet
 static uint8_t tool_holder_state;
 static uint8_t tip_change_state;
+static event_queue hid_events;		// TIM14 to the state machine
 
 // --- handlers ---
 void hid__init(void){
+	event_queue_init(&hid_events);
 	button_init(&tool_holder_sensor, STAND_GPIO_Port, STAND_Pin, INVERTED);
 	button_init(&tip_change_sensor, TIP_REMOVER_GPIO_Port, TIP_REMOVER_Pin, INVERTED);
 	button_init(&mmi_button, ENC_SW_GPIO_Port, ENC_SW_Pin, INVERTED);
@@ -28,37 +31,46 @@ void hid__init(void){
 }
 
 void hid__poll(void){
-	mmi_button_event = button_event(&mmi_button);
+	uint8_t new_button_event = button_event(&mmi_button);
+	if (new_button_event != NO_PRESS) {
+		event_queue_push(&hid_events, EVENT_BUTTON, new_button_event);
+	}
 	mmi_encoder_event = encoder_event(&mmi_encoder);
+	if (mmi_encoder_event != NO_CHANGE) {
+		mmi_encoder_delta += get_encoder_delta(&mmi_encoder);
+	}
+	// Rotation that doesn't fit into the queue is kept and sent with the next poll
+	if ((mmi_encoder_delta != 0) && event_queue_push(&hid_events, EVENT_ENCODER, mmi_encoder_delta)) {
+		mmi_encoder_delta = 0;
+	}
 
 	static uint32_t standby_delay_tick_ms = 0;
 	static uint32_t tip_change_delay_tick_ms = 0;
+	uint8_t new_tool_holder_state = tool_holder_state;
+	uint8_t new_tip_change_state = tip_change_state;
 
 	if (button_state(&tool_holder_sensor)) {
-		tool_holder_state = SET;
+		new_tool_holder_state = SET;
 		standby_delay_tick_ms = HAL_GetTick() + STANDBY_DELAY_MS;
 	} else if (HAL_GetTick() > standby_delay_tick_ms) {
-		tool_holder_state = RESET;
+		new_tool_holder_state = RESET;
 	}
 
 	if (button_state(&tip_change_sensor)) {
-		tip_change_state = SET;
+		new_tip_change_state = SET;
 		tip_change_delay_tick_ms = HAL_GetTick() + TIP_CHANGE_DELAY_MS;
 	} else if (HAL_GetTick() > tip_change_delay_tick_ms) {
-		tip_change_state = RESET;
+		new_tip_change_state = RESET;
 	}
 
-	if (mmi_encoder_event != NO_CHANGE) {
-		int16_t new_temp = get_set_temp();
-		new_temp += (TEMP_STEPS * get_encoder_delta(&mmi_encoder));
-
-		if (new_temp > MAX_TEMP) {
-			new_temp = MAX_TEMP;
-		} else if (new_temp < MIN_TEMP) {
-			new_temp = MIN_TEMP;
-		}
-
-		set_new_temp(new_temp);
+	// Only changes are sent. A change that doesn't fit into the queue is sent again next poll
+	if ((new_tool_holder_state != tool_holder_state)
+			&& event_queue_push(&hid_events, EVENT_TOOL_HOLDER, new_tool_holder_state)) {
+		tool_holder_state = new_tool_holder_state;
+	}
+	if ((new_tip_change_state != tip_change_state)
+			&& event_queue_push(&hid_events, EVENT_TIP_CHANGER, new_tip_change_state)) {
+		tip_change_state = new_tip_change_state;
 	}
 	button_scan(&tool_holder_sensor);
 	button_scan(&tip_change_sensor);
@@ -77,3 +89,7 @@ uint8_t hid__get_stand_state(void){
 uint8_t hid__get_tip_change_state(void){
 	return button_state(&tip_change_sensor);
 }
+
+event_queue *hid__get_events(void){
+	return &hid_events;
+}
@@ -0,0 +1,68 @@
+/*
+ * isr_stats.c
+ *
+ * Interrupt latency and duration statistics: count, min, max and a log2 histogram of µs values
+ */
+
+#include "isr_stats.h"
+#include <stdio.h>
+
+/******    functions    ******/
+void isr_stats_reset(isr_stats *const self) {
+	// A record preempting the reset counts from 0 again, clear once more then
+	volatile isr_stats *stats = self;
+	do {
+		stats->count = 0;
+		stats->min = UINT16_MAX;
+		stats->max = 0;
+		for (uint8_t i = 0; i < ISR_STATS_BUCKETS; i++) {
+			stats->histogram[i] = 0;
+		}
+	} while (stats->count != 0);
+}
+
+void isr_stats_record(isr_stats *const self, uint16_t value_us) {
+	// Bucket = number of significant bits, no CLZ instruction on the M0
+	uint8_t bucket = 0;
+	for (uint16_t value = value_us; value && (bucket < ISR_STATS_BUCKETS - 1); value >>= 1) {
+		bucket++;
+	}
+	if (self->histogram[bucket] < UINT16_MAX) {
+		self->histogram[bucket]++;
+	}
+	if (value_us < self->min) {
+		self->min = value_us;
+	}
+	if (value_us > self->max) {
+		self->max = value_us;
+	}
+	self->count++;
+}
+
+void isr_stats_copy(const isr_stats *const self, isr_stats *const copy) {
+	// The interrupt records in one piece, the copy is consistent if the count did not change meanwhile
+	const volatile isr_stats *stats = self;
+	uint32_t count;
+	do {
+		count = stats->count;
+		copy->count = count;
+		copy->min = stats->min;
+		copy->max = stats->max;
+		for (uint8_t i = 0; i < ISR_STATS_BUCKETS; i++) {
+			copy->histogram[i] = stats->histogram[i];
+		}
+	} while (stats->count != count);
+}
+
+int isr_stats_format(const isr_stats *const self, const char *name, char *buffer, uint16_t length) {
+	// "name n=123 min=4 max=17 | 0 0 12 111 0 ..." (histogram buckets from 0µs up)
+	int written = snprintf(buffer, length, "%s n=%lu min=%u max=%u |", name, (unsigned long)self->count,
+			self->count ? self->min : 0, self->max);
+	for (uint8_t i = 0; (i < ISR_STATS_BUCKETS) && (written > 0) && (written < length); i++) {
+		written += snprintf(buffer + written, length - written, " %u", self->histogram[i]);
+	}
+	if ((written > 0) && (written < length)) {
+		written += snprintf(buffer + written, length - written, "\r\n");
+	}
+	return written;
+}
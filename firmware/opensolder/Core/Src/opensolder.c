@@ -8,9 +8,8 @@
  * Copyright (c) 2022 Håvard Jakobsen
  *
  * TODO:
- * - implement better power regulation: PID or other alternative
  * - Better error handling
- * - Regular pcb temp readings for overheating protection and cold junction compensation
+ * - PCB overheating protection
  * - Settings menu	--- problem: there is no eeprom. a settings menu is useless
  * - "sleep-mode" to halt all heating and just show OFF after a elapsed amount of time after standby
  */
@@ -20,119 +19,240 @@
 #include "gui.h"
 #include "timers.h"
 #include "hid.h"
+#include "../../Drivers/pcb_temperature/inc/pcb_temperature.h"
+#include "usb_console.h"
+
+/******    Local Function Declarations    ******/
+static void state_task(void);
+static uint8_t state_task_consume_events(void);
+static void change_set_temp(int16_t encoder_steps);
+static void display_task(void);
+static void pcb_temperature_task(void);
+static void tip_insert_task(void);
 
 /******    File Scope Variables    ******/
 static uint8_t system_state;		// error, idle, standby, sleep, operational, initial (default)
 static uint8_t tool_state;			// heating, cooling, idle 	//	TODO: Move to separate class
 static uint8_t toolholder_state;	// error, present, absent	//	TODO: Move to separate class
 static uint8_t toolchanger_state;	// error, present, absent	//	TODO: Move to separate class
+static uint8_t tool_tip_state = TIP_NOT_DETECTED;	// last EVENT_TIP_STATE
+static scheduler tasks;
+static uint8_t tip_insert_task_id;
+static uint8_t tip_inserted = SET;		// the tip was detected for TIP_CHANGE_DELAY_MS, set by tip_insert_task()
 
 
 /******    Init    ******/
 void opensolder_init(void) {
 	timer_init();
+	heater_init();
 	HAL_I2C_Init(&hi2c1);
 	HAL_ADCEx_Calibration_Start(&hadc);
 	HAL_Delay(50); // Wait for calibration to finish
+	tip_thermocouple_init();	// starts the ADC, after the calibration
 	hid__init();
-	init_display(SPLASHSCREEN_TIMEOUT_MS);
+	init_display();
 	system_state = INIT_STATE;
+
+	// The state machine and the display start when the splash screen timed out
+	uint32_t now_ms = HAL_GetTick();
+	scheduler_init(&tasks, get_timestamp_us, now_ms);
+	scheduler_add_task(&tasks, state_task, "state", STATE_TASK_PERIOD_MS, now_ms + SPLASHSCREEN_TIMEOUT_MS);
+	scheduler_add_task(&tasks, display_task, "display", DISPLAY_TASK_PERIOD_MS, now_ms + SPLASHSCREEN_TIMEOUT_MS);
+	scheduler_add_task(&tasks, pcb_temperature_task, "pcb_temp", PCB_TEMP_READ_INTERVAL_MS, now_ms);
+	scheduler_add_task(&tasks, usb_console__poll, "usb_console", USB_CONSOLE_TASK_PERIOD_MS, now_ms);
+	tip_insert_task_id = scheduler_add_task(&tasks, tip_insert_task, "tip_insert", 0, now_ms);	// one-shot, armed by the state machine
 }
 
 // --- handlers ---
-/** opensolder synchronous main system state machine
+// Called from the main() loop: runs the due tasks one per call, sleeps until the next interrupt
+// (SysTick at the latest) when no task is due
+void opensolder_main(void) {
+	if (!scheduler_run(&tasks, HAL_GetTick())) {
+		__WFI();
+	}
+}
+
+/** opensolder synchronous main system state machine, STATE_TASK_PERIOD_MS task
  * main state machine controls:
- * - Display
  * - Menu
  * - Error, Idle, Standby, Sleep, Operational State
  *
  *
- * opensolder_main implements:
+ * state_task implements:
  * - system state
- * opensoder_main extends:
+ * state_task extends:
  * - tool state
  * - toolholder state
  * - toolchanger state
- * - display state
  * - tip heater state
  * - tip thermocouple state
  * - hid input state
  */
-void opensolder_main(void) {
+static void state_task(void) {
 	static uint32_t standby_timeout_tick_ms = 0;
-		static uint32_t tip_insert_delay_tick_ms = 0;
-		uint8_t tool_tip_state = get_tip_state();
-
-		if (HAL_GetTick() > get_ac_delay_tick()) {
-			error_handler();
-			display_message(AC_NOT_DETECTED);
-			system_state = ERROR_STATE;
-			return;
-		}
+	uint8_t button_event = state_task_consume_events();	// consumed every pass, so stale presses don't trigger later
+
+	if (HAL_GetTick() > get_ac_delay_tick()) {
+		error_handler();
+		display_message(AC_NOT_DETECTED);
+		system_state = ERROR_STATE;
+		return;
+	}
+
+	switch (system_state) {
+	case INIT_STATE:
+		set_tip_heater_off();
+		draw_default_display();
+		system_state = TIP_CHANGE_STATE;
+		break;
 
-		switch (system_state) {
-		case INIT_STATE:
-			set_tip_heater_off();
+	case TIP_CHANGE_STATE:
+		set_tip_heater_off();
+		if (tool_tip_state != TIP_DETECTED) {
+			tip_inserted = RESET;
+			scheduler_trigger(&tasks, tip_insert_task_id, HAL_GetTick(), TIP_CHANGE_DELAY_MS);	// restarts the delay
+		} else if ((tip_inserted == SET) && !toolchanger_state) {
 			draw_default_display();
+			system_state = OFF_STATE;
+		}
+		break;
+
+	case OFF_STATE:
+		set_tip_heater_off();
+		if (toolchanger_state || (tool_tip_state != TIP_DETECTED)) {
 			system_state = TIP_CHANGE_STATE;
-			break;
+		} else if (!toolholder_state) {
+			system_state = ON_STATE;
+		}
+		break;
 
-		case TIP_CHANGE_STATE:
-			set_tip_heater_off();
-			if (tool_tip_state != TIP_DETECTED) {
-				tip_insert_delay_tick_ms = HAL_GetTick() + TIP_CHANGE_DELAY_MS;
-				display_message(tool_tip_state);
-			} else if ((tool_tip_state == TIP_DETECTED)
-					&& (HAL_GetTick() > tip_insert_delay_tick_ms)
-					&& !tip_change_state) {
-				draw_default_display();
-				system_state = OFF_STATE;
-			}
-			break;
+	case ON_STATE:
+		if (toolchanger_state || (tool_tip_state != TIP_DETECTED)) {
+			system_state = TIP_CHANGE_STATE;
+		} else if (toolholder_state) {
+			standby_timeout_tick_ms = HAL_GetTick() + (STANDBY_TIME_S * 1000);
+			system_state = STANDBY_STATE;
+		} else if (button_event == LONG_PRESS) {
+			heater_start_autotune();
+			system_state = AUTOTUNE_STATE;
+		} else if (button_event == SHORT_PRESS) {	// toggle between zero cross and phase control
+			set_heater_mode((get_heater_mode() == HEATER_MODE_PHASE) ? HEATER_MODE_ZERO_CROSS : HEATER_MODE_PHASE);
+		}
+		break;
 
-		case OFF_STATE:
-			set_tip_heater_off();
-			if (tip_change_state || (tool_tip_state != TIP_DETECTED)) {
-				system_state = TIP_CHANGE_STATE;
-			} else if (!tool_holder_state) {
-				system_state = ON_STATE;
-			}
-			update_display();
-			break;
+	case AUTOTUNE_STATE:
+		if (toolchanger_state || (tool_tip_state != TIP_DETECTED)) {
+			heater_stop_autotune();
+			system_state = TIP_CHANGE_STATE;
+		} else if (toolholder_state || (get_autotune_state() != AUTOTUNE_RUNNING)) {
+			heater_stop_autotune();		// aborted or finished, the PID continues with the new or the previous gains
+			system_state = ON_STATE;
+		}
+		break;
 
-		case ON_STATE:
-			if (tip_change_state || (tool_tip_state != TIP_DETECTED)) {
-				system_state = TIP_CHANGE_STATE;
-			} else if (tool_holder_state) {
-				standby_timeout_tick_ms = HAL_GetTick() + (STANDBY_TIME_S * 1000);
-				system_state = STANDBY_STATE;
-			}
-			update_display();
-			break;
+	case STANDBY_STATE:
+		if (toolchanger_state || (tool_tip_state != TIP_DETECTED)) {
+			system_state = TIP_CHANGE_STATE;
+		} else if (!toolholder_state) {
+			system_state = ON_STATE;
+		} else if (HAL_GetTick() > standby_timeout_tick_ms) {
+			system_state = OFF_STATE;
+		}
+		break;
 
-		case STANDBY_STATE:
-			if (tip_change_state || (tool_tip_state != TIP_DETECTED)) {
-				system_state = TIP_CHANGE_STATE;
-			} else if (!tool_holder_state) {
-				system_state = ON_STATE;
-			} else if (HAL_GetTick() > standby_timeout_tick_ms) {
-				system_state = OFF_STATE;
-			}
-			update_display();
-			break;
+	case ERROR_STATE:
+		error_handler();
+		system_state = INIT_STATE;
+		break;
 
-		case ERROR_STATE:
-			error_handler();
-			system_state = INIT_STATE;
-			break;
+	default:
+		system_state = ERROR_STATE;
+		break;
+	}
+}
 
+// Drains the event queues of the interrupts into the states seen by the state machine. Stops after a button
+// event, so the state machine handles every press, the remaining events are consumed in the next pass
+static uint8_t state_task_consume_events(void) {
+	event new_event;
+	while (event_queue_pop(get_tip_events(), &new_event)) {
+		if (new_event.type == EVENT_TIP_STATE) {
+			tool_tip_state = new_event.value;
+		}
+	}
+	while (event_queue_pop(hid__get_events(), &new_event)) {
+		switch (new_event.type) {
+		case EVENT_BUTTON:
+			return new_event.value;
+		case EVENT_ENCODER:
+			change_set_temp(new_event.value);
+			break;
+		case EVENT_TOOL_HOLDER:
+			toolholder_state = new_event.value;
+			break;
+		case EVENT_TIP_CHANGER:
+			toolchanger_state = new_event.value;
+			break;
 		default:
-			system_state = ERROR_STATE;
 			break;
 		}
+	}
+	return NO_PRESS;
+}
+
+static void change_set_temp(int16_t encoder_steps) {
+	int16_t new_temp = get_set_temp();
+	new_temp += (TEMP_STEPS * encoder_steps);
+
+	if (new_temp > MAX_TEMP) {
+		new_temp = MAX_TEMP;
+	} else if (new_temp < MIN_TEMP) {
+		new_temp = MIN_TEMP;
+	}
+
+	set_new_temp(new_temp);
+}
+
+// DISPLAY_TASK_PERIOD_MS task, renders the screen of the current system state
+static void display_task(void) {
+	switch (system_state) {
+	case TIP_CHANGE_STATE:
+		if (tool_tip_state != TIP_DETECTED) {
+			display_message(tool_tip_state);
+		} else {
+			flush_display();
+		}
+		break;
+
+	case OFF_STATE:
+	case ON_STATE:
+	case AUTOTUNE_STATE:
+	case STANDBY_STATE:
+		update_display();
+		break;
+
+	default:
+		flush_display();	// the state machine draws the init and error screens
+		break;
+	}
+}
+
+// PCB_TEMP_READ_INTERVAL_MS task. The read completes in the background, the cold junction gets the previous reading
+static void pcb_temperature_task(void) {
+	pcb_temperature_driver__poll();
+	set_cold_junction_temp(pcb_temperature_driver__get_last_temperature());
+}
+
+// One-shot task, runs TIP_CHANGE_DELAY_MS after the state machine last saw no tip
+static void tip_insert_task(void) {
+	tip_inserted = SET;
 }
 
 // --- getters ---
 uint8_t get_system_state(void) {
 	return system_state;
 }
+
+scheduler *get_scheduler(void) {
+	return &tasks;
+}
@@ -0,0 +1,72 @@
+/*
+ * pid.c
+ *
+ * Fixed-point PID regulator for embedded systems
+ */
+
+#include "pid.h"
+
+/******    Local Function Declarations    ******/
+static int32_t pid_clamp(int64_t value, int32_t min, int32_t max);
+
+/******    functions    ******/
+void pid_init(pid_controller *const self, int32_t kp, int32_t ki, int32_t kd, int32_t out_min, int32_t out_max) {
+	self->out_min = out_min;
+	self->out_max = out_max;
+	pid_set_gains(self, kp, ki, kd);
+	pid_reset(self);
+}
+
+void pid_set_gains(pid_controller *const self, int32_t kp, int32_t ki, int32_t kd) {
+	self->kp = kp;
+	self->ki = ki;
+	self->kd = kd;
+}
+
+void pid_reset(pid_controller *const self) {
+	self->integrator = 0;
+	self->prev_measurement = 0;
+	self->initialized = 0;
+}
+
+int32_t pid_update(pid_controller *const self, int16_t setpoint, int16_t measurement, uint16_t dt_ms) {
+	int32_t error = setpoint - measurement;
+	int32_t output;
+
+	if (!self->initialized) {
+		self->prev_measurement = measurement;	// no derivative kick on the first sample
+		self->initialized = 1;
+	}
+	if (dt_ms == 0) {
+		dt_ms = 1;
+	}
+
+	// The integral step and the derivative are 64 bit: autotuned gains times a full scale error and a long
+	// dt_ms (up to 255 half cycles without a reading) overflow 32 bit
+	int32_t p_term = self->kp * error;
+	int32_t d_term = pid_clamp(-((int64_t)self->kd * (measurement - self->prev_measurement) * PID_TIME_BASE_MS) / dt_ms,
+			-PID_OUTPUT_MAX, PID_OUTPUT_MAX);
+	self->prev_measurement = measurement;
+
+	// Anti-windup: the integral step is dropped if the output with it saturates in the direction of the error.
+	// Checking the output before the step is not enough, during a heat up the derivative holds it below the
+	// limit while the integrator keeps growing
+	int32_t integrator = pid_clamp(self->integrator + (int64_t)self->ki * error * dt_ms,
+			self->out_min << PID_TIME_BASE_SHIFT, self->out_max << PID_TIME_BASE_SHIFT);
+	output = p_term + (integrator >> PID_TIME_BASE_SHIFT) + d_term;
+	if (!((output > self->out_max) && (error > 0)) && !((output < self->out_min) && (error < 0))) {
+		self->integrator = integrator;
+	}
+
+	output = p_term + (self->integrator >> PID_TIME_BASE_SHIFT) + d_term;
+	return pid_clamp(output, self->out_min, self->out_max);
+}
+
+static int32_t pid_clamp(int64_t value, int32_t min, int32_t max) {
+	if (value > max) {
+		return max;
+	} else if (value < min) {
+		return min;
+	}
+	return value;
+}
@@ -0,0 +1,139 @@
+/*
+ * scheduler.c
+ *
+ * Cooperative run-to-completion task scheduler with deadlines and runtime accounting
+ */
+
+#include "scheduler.h"
+#include <stdio.h>
+
+/******    Local Function Declarations    ******/
+static uint8_t scheduler_is_due(const scheduler_task *const task, uint32_t now_ms);
+static void scheduler_execute(scheduler *const self, scheduler_task *const task, uint32_t now_ms);
+
+/******    functions    ******/
+void scheduler_init(scheduler *const self, scheduler_clock_function clock_us, uint32_t now_ms) {
+	self->task_count = 0;
+	self->clock_us = clock_us;
+	scheduler_reset_stats(self, now_ms);
+}
+
+uint8_t scheduler_add_task(scheduler *const self, scheduler_task_function function, const char *name, uint32_t period_ms, uint32_t first_run_ms) {
+	if (self->task_count >= SCHEDULER_MAX_TASKS) {
+		return SCHEDULER_NO_TASK;
+	}
+	scheduler_task *task = &self->tasks[self->task_count];
+	task->function = function;
+	task->name = name;
+	task->period_ms = period_ms;
+	task->deadline_ms = first_run_ms;
+	task->armed = 1;
+	task->runs = 0;
+	task->overruns = 0;
+	task->total_runtime_us = 0;
+	task->max_runtime_us = 0;
+	task->max_lateness_ms = 0;
+	return self->task_count++;
+}
+
+void scheduler_trigger(scheduler *const self, uint8_t task, uint32_t now_ms, uint32_t delay_ms) {
+	if (task >= self->task_count) {
+		return;
+	}
+	self->tasks[task].deadline_ms = now_ms + delay_ms;
+	self->tasks[task].armed = 1;
+}
+
+uint8_t scheduler_run(scheduler *const self, uint32_t now_ms) {
+	// Earliest deadline first among the due tasks
+	scheduler_task *next = 0;
+	for (uint8_t i = 0; i < self->task_count; i++) {
+		scheduler_task *task = &self->tasks[i];
+		if (scheduler_is_due(task, now_ms)
+				&& ((next == 0) || ((int32_t)(task->deadline_ms - next->deadline_ms) < 0))) {
+			next = task;
+		}
+	}
+	if (next == 0) {
+		return 0;	// nothing due, the caller can sleep
+	}
+	scheduler_execute(self, next, now_ms);
+	return 1;
+}
+
+void scheduler_reset_stats(scheduler *const self, uint32_t now_ms) {
+	for (uint8_t i = 0; i < self->task_count; i++) {
+		self->tasks[i].runs = 0;
+		self->tasks[i].overruns = 0;
+		self->tasks[i].total_runtime_us = 0;
+		self->tasks[i].max_runtime_us = 0;
+		self->tasks[i].max_lateness_ms = 0;
+	}
+	self->busy_us = 0;
+	self->stats_start_ms = now_ms;
+}
+
+const scheduler_task *scheduler_get_task(scheduler *const self, uint8_t task) {
+	return (task < self->task_count) ? &self->tasks[task] : 0;
+}
+
+uint8_t scheduler_get_task_count(scheduler *const self) {
+	return self->task_count;
+}
+
+uint16_t scheduler_get_load(scheduler *const self, uint32_t now_ms) {
+	// Busy µs per elapsed ms first, so the Q10 result can't overflow on long statistics windows
+	uint32_t elapsed_ms = now_ms - self->stats_start_ms;
+	if (elapsed_ms == 0) {
+		return 0;
+	}
+	uint32_t busy_per_ms = (uint32_t)(self->busy_us / elapsed_ms);
+	if (busy_per_ms > 1000) {
+		busy_per_ms = 1000;
+	}
+	return (busy_per_ms << SCHEDULER_LOAD_SHIFT) / 1000;
+}
+
+int scheduler_format_task(scheduler *const self, uint8_t task, char *buffer, uint16_t length) {
+	// "name runs=120 avg=35 max=410 late=1 overruns=0" (runtimes in µs, lateness in ms)
+	const scheduler_task *t = scheduler_get_task(self, task);
+	if (t == 0) {
+		return 0;
+	}
+	return snprintf(buffer, length, "%s runs=%lu avg=%lu max=%u late=%u overruns=%lu\r\n", t->name, (unsigned long)t->runs,
+			(unsigned long)(t->runs ? t->total_runtime_us / t->runs : 0), t->max_runtime_us, t->max_lateness_ms,
+			(unsigned long)t->overruns);
+}
+
+static uint8_t scheduler_is_due(const scheduler_task *const task, uint32_t now_ms) {
+	return task->armed && ((int32_t)(now_ms - task->deadline_ms) >= 0);
+}
+
+static void scheduler_execute(scheduler *const self, scheduler_task *const task, uint32_t now_ms) {
+	uint32_t lateness_ms = now_ms - task->deadline_ms;
+	if (lateness_ms > task->max_lateness_ms) {
+		task->max_lateness_ms = (lateness_ms > UINT16_MAX) ? UINT16_MAX : lateness_ms;
+	}
+
+	// Set up the next run before the task runs, so the task can re-trigger itself.
+	// Periodic runs are counted from the deadline so the period doesn't drift
+	if (task->period_ms == 0) {
+		task->armed = 0;
+	} else if (lateness_ms >= task->period_ms) {
+		task->overruns++;
+		task->deadline_ms = now_ms + task->period_ms;
+	} else {
+		task->deadline_ms += task->period_ms;
+	}
+
+	uint16_t start_us = self->clock_us();
+	task->function();
+	uint16_t runtime_us = self->clock_us() - start_us;
+
+	task->runs++;
+	task->total_runtime_us += runtime_us;
+	if (runtime_us > task->max_runtime_us) {
+		task->max_runtime_us = runtime_us;
+	}
+	self->busy_us += runtime_us;
+}
@@ -0,0 +1,22 @@
+/*
+ * thermocouple_table.c
+ *
+ * GENERATED by tools/thermocouple_table.py, do not edit
+ *
+ * Tip temperature (Q4 °C) at every 64 ADC counts of thermocouple EMF
+ */
+
+#include "thermocouple_table.h"
+
+const uint16_t thermocouple_table[THERMOCOUPLE_TABLE_LENGTH] = {
+	0, 143, 285, 425, 563, 700, 835, 968,
+	1100, 1231, 1360, 1487, 1614, 1739, 1863, 1986,
+	2108, 2228, 2348, 2467, 2584, 2701, 2817, 2933,
+	3047, 3161, 3274, 3386, 3498, 3609, 3720, 3830,
+	3939, 4048, 4156, 4264, 4371, 4478, 4585, 4691,
+	4796, 4901, 5006, 5111, 5215, 5318, 5422, 5525,
+	5628, 5730, 5832, 5934, 6036, 6137, 6238, 6339,
+	6440, 6540, 6640, 6740, 6840, 6939, 7038, 7137,
+	7236, 7335, 7434, 7532, 7630, 7728, 7826, 7924,
+	8021,
+};
@@ -9,8 +9,18 @@
  * notes (originally from temperature.c:
  *  * - TIMELINE -
  * 1. Zero Cross Interrupt happens some µs before the "true" zero cross because
- *    of optocoupler hysteresis. ZC interrupt starts TIM6
- * 2. TIM6 interrupt happens at true ZC. Two options:
+ *    of optocoupler hysteresis. TIM14 captures the edge in hardware (ZERO_CROSS is also
+ *    TIM14_CH1), ZC interrupt converts it to a TIM17 timestamp (1µs) and feeds
+ *    the zero cross PLL. Accepted edges (re)start TIM6 to the predicted true zero cross.
+ *    Until the mains frequency (50/60Hz) is detected, the edge intervals are classified
+ *    first, the PLL then acquires from the detected half cycle
+ *    The optocoupler pulse is symmetric around the true zero cross: the falling edge
+ *    calibrates the offset continuously to half the pulse width
+ *    In phase control mode, TIM6 is also armed within a heating half cycle for the
+ *    trailing edge turn off, and re-armed to the next true zero cross from there
+ * 2. TIM6 interrupt happens at true ZC. If no edge was seen since the last one, the PLL
+ *    coasts on its predicted period. While locked, TIM6 is re-armed for the next
+ *    predicted zero cross, so missing edges do not skip a half cycle. Two options:
  * 		A - turn heater on:
  * 			- Set TIP_CLAMP as output, pull low (prevents noise on thermocouple amplifier input)
  * 			- Turn heater on
@@ -21,62 +31,226 @@
  * 		- Check if this is the first or second TIM7 interrupt. Two options:
  * 		A - First interrupt (2ms after ZC):
  * 			- Set TIP_CLAMP pin to input state (high impedance)
- * 			- Do a tip_state check if TIP_CHECK_INTERVAL has passed (checks if tip is inserted)
+ * 			- Do a tip_state check if TIP_CHECK_INTERVAL_MS has passed (checks if tip is inserted)
  * 		B - Second interrupt (4ms after ZC):
- * 			- Start the ADC reading
+ * 			- Start TIM15, which triggers the ADC conversions in hardware
  */
 
 #include "timers.h"
 
 static volatile uint32_t ac_delay_tick_ms = 0;
-static void zerocross_interrupt(uint16_t GPIO_Pin);
+static volatile uint16_t ac_half_cycle_us = AC_HALF_CYCLE_50HZ_US;	// measured mains half cycle, 50Hz until detected
+static volatile uint8_t ac_detection_interval_ms = 0;
+static volatile uint8_t ac_frequency_detected = RESET;
+static zerocross_pll zerocross;
+static volatile uint8_t zerocross_edge_seen = 0;	// an edge was accepted since the last true zero cross
+static uint16_t zerocross_rising_timestamp = 0;
+static uint16_t zerocross_offset_q4 = ZEROCROSS_OFFSET_US << 4;	// calibrated rising edge to true zero cross offset, Q4 µs
+static volatile uint8_t phase_off_pending = RESET;	// TIM6 is armed for the phase control turn off, not for a zero cross
+static isr_stats timer_isr_stats[TIMER_ISR_STATS_COUNT];	// latency and duration of the fast path interrupts, timestamps from TIM17
+static uint16_t zerocross_event_timestamp = 0;	// TIM17 time of the last TIM6 update event
+static void zerocross_interrupt(uint16_t timestamp);
+static void zerocross_timeout(void);
+static void zerocross_calibrate_offset(uint16_t timestamp);
+static void ac_frequency_detect(uint16_t timestamp);
+static void ac_set_half_cycle(uint16_t half_cycle_us);
+static void timer_start_tim6(int16_t delay_us);
+static void timer_zerocross_capture_init(void);
 
 /******    Callback Functions    ******/
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
-	zerocross_interrupt(GPIO_Pin);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+	// TIM6 and TIM7 are handled by the register level fast paths below, they don't get here
+	if (htim == &htim14){	// timer14 handles a 2msec system tick to trigger
+		hid__poll();
+	}
 }
 
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {		// TODO: check race condition. What if both interrupts fire at the same time
-	if (htim == &htim6) {	// TIM6 interrupt, indicating true AC zero cross. This is where to turn the heater on/off to avoid inductive spikes. Auto-Reload
-		timer_stop_zerocross_timeout();
-		heater_control_timer_handler();
+/******    Fast Path Interrupt Handlers    ******/
+// Called first from the IRQ handlers in stm32f0xx_it.c. They check and clear the flags on register level
+// and return SET if the interrupt was handled, RESET leaves it to the HAL handler.
+
+// TIM6 and TIM7 keep counting after the update event (1µs ticks), their counter at the entry is the latency.
+// The zero cross edge is captured by TIM14 (1µs ticks, 2ms period), the counter since the capture is the latency.
+
+OPENSOLDER_RAMFUNC uint8_t timer_zerocross_irq_handler(void) {
+	if (!(EXTI->PR & ZERO_CROSS_Pin)) {
+		return RESET;
 	}
-	if (htim == &htim7) {	// timer 7 handles a 2msec delay. Started after switching off the heater output. No Auto Reload
-		tip_timer_handler();
+	uint16_t entry = TIM17->CNT;
+	int16_t latency = TIM14->CNT - TIM14->CCR1;
+	if (latency < 0) {
+		latency += TIM14->ARR + 1;	// captured before the last TIM14 update
 	}
-	if (htim == &htim14){	// timer14 handles a 2msec system tick to trigger
-		hid__poll();
-		tip_check_counter_increase();
+	EXTI->PR = ZERO_CROSS_Pin;	// write 1 to clear
+	zerocross_interrupt(entry - latency);	// TIM17 time of the edge
+	isr_stats_record(&timer_isr_stats[TIMER_ISR_STATS_EDGE_LATENCY], latency);
+	isr_stats_record(&timer_isr_stats[TIMER_ISR_STATS_EDGE_DURATION], TIM17->CNT - entry);
+	return SET;
+}
+
+OPENSOLDER_RAMFUNC uint8_t timer_zerocross_timeout_irq_handler(void) {
+	if (!(TIM6->SR & TIM_SR_UIF)) {
+		return RESET;
+	}
+	uint16_t entry = TIM17->CNT;
+	uint16_t latency = TIM6->CNT;
+	zerocross_event_timestamp = entry - latency;
+	TIM6->SR = ~TIM_SR_UIF;		// write 0 to clear
+	zerocross_timeout();
+	isr_stats_record(&timer_isr_stats[TIMER_ISR_STATS_ZEROCROSS_LATENCY], latency);
+	isr_stats_record(&timer_isr_stats[TIMER_ISR_STATS_ZEROCROSS_DURATION], TIM17->CNT - entry);
+	return SET;
+}
+
+OPENSOLDER_RAMFUNC uint8_t timer_tip_measure_delay_irq_handler(void) {
+	if (!(TIM7->SR & TIM_SR_UIF)) {
+		return RESET;
 	}
+	uint16_t entry = TIM17->CNT;
+	uint16_t latency = TIM7->CNT;
+	TIM7->SR = ~TIM_SR_UIF;
+	tip_timer_handler();	// timer 7 handles a 2msec delay. Started after switching off the heater output. No Auto Reload
+	isr_stats_record(&timer_isr_stats[TIMER_ISR_STATS_TIP_TIMER_LATENCY], latency);
+	isr_stats_record(&timer_isr_stats[TIMER_ISR_STATS_TIP_TIMER_DURATION], TIM17->CNT - entry);
+	return SET;
+}
+
+// The whole chain from the scheduled switching time to the pin: TIM6 entry latency, the fast path and the
+// switching decision. Only valid within the TIM6 interrupt
+OPENSOLDER_RAMFUNC void timer_record_heater_switch(void) {
+	isr_stats_record(&timer_isr_stats[TIMER_ISR_STATS_HEATER_SWITCH_LATENCY], TIM17->CNT - zerocross_event_timestamp);
 }
 
 /******    ISR Functions    ******/
 // ISR: Rising edge is detected on ZERO_CROSS pin. Start TIM6, which is a delay for when the true AC zero cross happens
-static void zerocross_interrupt(uint16_t GPIO_Pin) {
-	if (GPIO_Pin == ZERO_CROSS_Pin) {
-		timer_start_zerocross_timeout();	// start the timeout until true zero cross
+// The falling edge ends the optocoupler pulse and is only used for the offset calibration
+OPENSOLDER_RAMFUNC static void zerocross_interrupt(uint16_t timestamp) {
+	if (!(ZERO_CROSS_GPIO_Port->IDR & ZERO_CROSS_Pin)) {
+		zerocross_calibrate_offset(timestamp);
+		return;
+	}
+	zerocross_rising_timestamp = timestamp;
+	if (!ac_frequency_detected) {
+		ac_frequency_detect(timestamp);
+	}
+	if (zerocross_pll_edge(&zerocross, timestamp) == ZEROCROSS_PLL_ACCEPTED) {	// noise and late edges are left to the PLL
+		if (phase_off_pending) {	// never conduct into the next half cycle
+			phase_off_pending = RESET;
+			heater_phase_off_timer_handler();
+		}
+		zerocross_edge_seen = 1;
+		timer_start_zerocross_timeout(zerocross_pll_get_zero(&zerocross));	// start the timeout until true zero cross
 	}
 }
 
+// ISR: TIM6, indicating true AC zero cross. This is where to turn the heater on/off to avoid inductive spikes
+OPENSOLDER_RAMFUNC static void zerocross_timeout(void) {
+	timer_stop_zerocross_timeout();
+	if (phase_off_pending) {	// trailing edge within a heating half cycle, not a zero cross
+		phase_off_pending = RESET;
+		heater_phase_off_timer_handler();
+		timer_record_heater_switch();
+		if (zerocross_pll_is_locked(&zerocross)) {
+			timer_start_zerocross_timeout(zerocross_pll_get_next_zero(&zerocross));
+		}
+		return;
+	}
+	heater_control_timer_handler();		// switch first, the rest is not timing critical
+	if (!zerocross_edge_seen) {
+		zerocross_pll_coast(&zerocross);	// edge missing, bridge it with the predicted period (unlocks when too many are missing)
+	}
+	zerocross_edge_seen = 0;
+	ac_delay_tick_ms = HAL_GetTick() + ac_detection_interval_ms;
+	tip_check_counter_increase();
+	if (!phase_off_pending && zerocross_pll_is_locked(&zerocross)) {
+		timer_start_zerocross_timeout(zerocross_pll_get_next_zero(&zerocross));
+	}
+}
+
+// Mains frequency detection: classify the raw edge intervals as 50Hz or 60Hz half cycles,
+// settle on a frequency after AC_FREQUENCY_DETECT_EDGES intervals in a row agree
+static void ac_frequency_detect(uint16_t timestamp) {
+	static uint16_t last_timestamp = 0;
+	static uint16_t last_half_cycle_us = 0;
+	static uint8_t agreeing_edges = 0;
+
+	uint16_t interval_us = timestamp - last_timestamp;
+	uint16_t half_cycle_us = 0;
+	last_timestamp = timestamp;
+
+	if ((interval_us > (AC_HALF_CYCLE_60HZ_US * 9) / 10) && (interval_us < (AC_HALF_CYCLE_60HZ_US + AC_HALF_CYCLE_50HZ_US) / 2)) {
+		half_cycle_us = AC_HALF_CYCLE_60HZ_US;
+	} else if ((interval_us >= (AC_HALF_CYCLE_60HZ_US + AC_HALF_CYCLE_50HZ_US) / 2) && (interval_us < (AC_HALF_CYCLE_50HZ_US * 11) / 10)) {
+		half_cycle_us = AC_HALF_CYCLE_50HZ_US;
+	}
+
+	if (!half_cycle_us || (half_cycle_us != last_half_cycle_us)) {
+		agreeing_edges = 0;		// noise or a frequency change, start over
+	} else if (++agreeing_edges >= AC_FREQUENCY_DETECT_EDGES) {
+		ac_set_half_cycle(half_cycle_us);
+		zerocross_pll_init(&zerocross, half_cycle_us, (zerocross_offset_q4 + 8) >> 4);	// the PLL acquires from the detected frequency
+		ac_frequency_detected = SET;
+	}
+	last_half_cycle_us = half_cycle_us;
+}
+
+// The optocoupler conducts on both half waves, the pin is high for a pulse centered on the true zero cross
+static void zerocross_calibrate_offset(uint16_t timestamp) {
+	uint16_t half_width_us = (uint16_t)(timestamp - zerocross_rising_timestamp) / 2;
+	if ((half_width_us < ZEROCROSS_OFFSET_MIN_US) || (half_width_us > ZEROCROSS_OFFSET_MAX_US)) {
+		return;		// glitch or a missed rising edge
+	}
+	zerocross_offset_q4 += ((int16_t)((half_width_us << 4) - zerocross_offset_q4)) >> ZEROCROSS_OFFSET_FILTER_SHIFT;
+	zerocross_pll_set_offset(&zerocross, (zerocross_offset_q4 + 8) >> 4);
+}
+
+static void ac_set_half_cycle(uint16_t half_cycle_us) {
+	ac_half_cycle_us = half_cycle_us;
+	ac_detection_interval_ms = ((uint32_t)half_cycle_us * AC_DETECTION_INTERVAL_PERCENT + 99999) / 100000;
+}
+
 
 // setters
 
-void timer_stop_zerocross_timeout(void){
+// TIM6 and TIM7 are started and stopped on register level, the HAL handle state is not used for them
+
+OPENSOLDER_RAMFUNC void timer_stop_zerocross_timeout(void){
 	// Timer6 = true zero cross (delay timer after zerocross interrupt)
-	HAL_TIM_Base_Stop_IT(&htim6);	// stop the timer
+	TIM6->CR1 &= ~TIM_CR1_CEN;	// stop the timer
+	TIM6->DIER &= ~TIM_DIER_UIE;
+}
+
+// Timer6 = true zero cross, fires at zero_timestamp (TIM17 time). Restarts the timer if it is already running
+OPENSOLDER_RAMFUNC void timer_start_zerocross_timeout(uint16_t zero_timestamp){
+	timer_start_tim6((int16_t)(zero_timestamp - TIM17->CNT));
 }
 
-// Timer6 = true zero cross (delay timer after zerocross interrupt)
-void timer_start_zerocross_timeout(void){
-	HAL_TIM_Base_Start_IT(&htim6);
-	ac_delay_tick_ms = HAL_GetTick() + AC_DETECTION_INTERVAL_MS;
+// Timer6 = phase control turn off, delay_us after the true zero cross that just happened
+OPENSOLDER_RAMFUNC void timer_start_phase_off_timeout(uint16_t delay_us){
+	phase_off_pending = SET;
+	timer_start_tim6(delay_us);
+}
+
+OPENSOLDER_RAMFUNC static void timer_start_tim6(int16_t delay_us) {
+	TIM6->CR1 &= ~TIM_CR1_CEN;
+	if (delay_us < 1) {
+		delay_us = 1;	// already passed (interrupt latency), fire right away
+	}
+	TIM6->ARR = delay_us;
+	TIM6->CNT = 0;
+	TIM6->SR = ~TIM_SR_UIF;
+	TIM6->DIER |= TIM_DIER_UIE;
+	TIM6->CR1 |= TIM_CR1_CEN;
 }
 
-void timer_stop_tip_measure_delay(void){
-	HAL_TIM_Base_Stop_IT(&htim7);
+OPENSOLDER_RAMFUNC void timer_stop_tip_measure_delay(void){
+	TIM7->CR1 &= ~TIM_CR1_CEN;
+	TIM7->DIER &= ~TIM_DIER_UIE;
 }
-void timer_start_tip_measure_delay(void){
-	HAL_TIM_Base_Stop_IT(&htim7);
+OPENSOLDER_RAMFUNC void timer_start_tip_measure_delay(void){
+	TIM7->SR = ~TIM_SR_UIF;
+	TIM7->DIER |= TIM_DIER_UIE;
+	TIM7->CR1 |= TIM_CR1_CEN;
 }
 
 
@@ -85,9 +259,52 @@ uint32_t get_ac_delay_tick(void) {
 	return ac_delay_tick_ms;
 }
 
+uint16_t get_ac_half_cycle_us(void) {
+	return ac_half_cycle_us;
+}
+
+uint16_t get_ac_half_cycles(uint16_t interval_ms) {
+	return ((uint32_t)interval_ms * 1000) / ac_half_cycle_us;
+}
+
+isr_stats *get_timer_isr_stats(uint8_t channel) {
+	return &timer_isr_stats[channel];
+}
+
+uint16_t get_timestamp_us(void) {
+	return TIM17->CNT;
+}
+
 
 // handlers
 void timer_init(void){
+	for (uint8_t i = 0; i < TIMER_ISR_STATS_COUNT; i++) {
+		isr_stats_reset(&timer_isr_stats[i]);
+	}
+	ac_set_half_cycle(AC_HALF_CYCLE_50HZ_US);
+	zerocross_pll_init(&zerocross, AC_HALF_CYCLE_50HZ_US, ZEROCROSS_OFFSET_US);
 	HAL_TIM_Encoder_Start(&htim2, TIM_CHANNEL_ALL);
+	timer_zerocross_capture_init();
 	HAL_TIM_Base_Start_IT(&htim14);
+	HAL_TIM_Base_Start(&htim17);
+}
+
+// ZERO_CROSS (PA4) is also TIM14_CH1: the input capture timestamps both edges in hardware, independent of the
+// interrupt latency. The EXTI keeps seeing the pin in alternate function mode. TIM17_CH1 (PA7, PB9) is not on this pin
+static void timer_zerocross_capture_init(void) {
+	GPIO_InitTypeDef gpio = {0};
+	gpio.Pin = ZERO_CROSS_Pin;
+	gpio.Mode = GPIO_MODE_AF_PP;
+	gpio.Pull = GPIO_PULLUP;
+	gpio.Speed = GPIO_SPEED_FREQ_LOW;
+	gpio.Alternate = GPIO_AF4_TIM14;
+	HAL_GPIO_Init(ZERO_CROSS_GPIO_Port, &gpio);
+
+	TIM_IC_InitTypeDef capture = {0};
+	capture.ICPolarity = TIM_INPUTCHANNELPOLARITY_BOTHEDGE;
+	capture.ICSelection = TIM_ICSELECTION_DIRECTTI;
+	capture.ICPrescaler = TIM_ICPSC_DIV1;
+	capture.ICFilter = 0;
+	HAL_TIM_IC_ConfigChannel(&htim14, &capture, TIM_CHANNEL_1);
+	HAL_TIM_IC_Start(&htim14, TIM_CHANNEL_1);
 }
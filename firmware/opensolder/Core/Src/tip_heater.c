@@ -7,38 +7,161 @@
 
 
 #include "tip_heater.h"
+#include "pid.h"
+#include "estimator.h"
 #include "../../Drivers/heater/inc/heater.h"	// HW driver layer to enable/disable the header.
 
+/******    Local Function Declarations    ******/
+static uint8_t heater_select_run_length(int16_t tip_temp, int16_t target_temp);
+static void heater_stats_count(uint16_t energy, uint8_t measurement);
+static void heater_switch_half_cycle(void);
+static void heater_phase_control(void);
+static uint16_t heater_phase_on_time(uint16_t power);
+
+/******    File Scope Variables    ******/
 static uint16_t set_temp = DEFAULT_TEMP;
+static pid_controller tip_pid;
+static autotune tip_autotune;
 
-static volatile uint8_t on_periods = 0;
-static volatile uint8_t power_bar_value = 0;
+static volatile uint16_t heater_power = 0;			// Q15 power demand, 0 = off, PID_OUTPUT_MAX = every heating half cycle on
+static uint32_t sigma_delta_accumulator = 0;		// Accumulated power demand not yet delivered to the tip
+static uint8_t half_cycle_polarity = 0;				// Toggles every AC half cycle. The absolute mains polarity is unknown, only the alternation matters
+static uint8_t measurement_polarity = 0;			// Polarity of the last measurement half cycle
+static int8_t polarity_balance = 0;					// Heating half cycles on polarity 1 minus heating half cycles on polarity 0
+static uint8_t heating_slot = 0;					// Number of heating half cycles since the last temp measurement
+static volatile uint8_t heating_run_length = MIN_ON_PERIODS;	// Heating half cycles before the next temp measurement, chosen by heater_control()
 static volatile uint32_t heater_power_history = 0; // DEBUG only - could be used for power histogram
+static volatile uint8_t half_cycles_since_sample = 0;	// AC half cycles since the last call of heater_control()
+static volatile uint8_t regulator_active = RESET;		// RESET after the heater was turned off, the PID state is stale
+static volatile uint8_t heater_mode = HEATER_MODE_ZERO_CROSS;
+static uint16_t heater_energy = 0;					// Q8 share of the current half cycle the heater is on (ESTIMATOR_HEATER_ON = whole half cycle)
+
+// Trailing edge phase control, resistive load: the share of the half cycle power delivered when conducting
+// from the zero cross to the phase angle θ is (θ - sin θ cos θ) / π. Inverted for 33 evenly spaced powers,
+// on time in Q15 of the half cycle.
+static const uint16_t heater_phase_table[HEATER_PHASE_TABLE_LENGTH] = {
+	0, 5615, 7162, 8286, 9212, 10018, 10746, 11417,
+	12046, 12643, 13216, 13770, 14308, 14836, 15356, 15871,
+	16383, 16896, 17411, 17931, 18459, 18997, 19551, 20124,
+	20721, 21350, 22021, 22749, 23555, 24481, 25605, 27152,
+	32767,
+};
+
+static uint8_t stats_half_cycles = 0;				// AC half cycles counted in the current statistics window
+static uint16_t stats_on_energy = 0;				// Q8 heater on time in the current window, in half cycles
+static uint8_t stats_measurements = 0;				// Measurement half cycles in the current window
+static volatile uint8_t heater_duty_percent = 0;	// Effective heater duty of the last window, measurement half cycles included
+static volatile uint16_t measurement_rate_hz = 0;	// Temp measurements per second of the last window
+
+void heater_init(void) {
+	pid_init(&tip_pid, PID_KP, PID_KI, PID_KD, 0, PID_OUTPUT_MAX);
+}
 
 // This function is called after the zerocross interrupt timeout happened
-void heater_control_timer_handler(void) {
+OPENSOLDER_RAMFUNC void heater_control_timer_handler(void) {
+	uint16_t past_energy = heater_energy;
+	heater_energy = 0;
+	heater_switch_half_cycle();		// switch first, the heater pin timing matters
+	timer_record_heater_switch();
+	tip_temp_estimator_predict(past_energy);	// propagate the tip temperature over the half cycle that just ended
+}
+
+OPENSOLDER_RAMFUNC static void heater_switch_half_cycle(void) {
 	heater_power_history <<= 1; // Records the tip power history of the past 32 AC half cycles. Power to tip = 1, no power = 0
-	power_bar_value = on_periods;
+	if (half_cycles_since_sample < UINT8_MAX) {
+		half_cycles_since_sample++;
+	}
 
-	// Switch heater on or off
-	if ((on_periods >= 1) && (get_tip_temp() < MAX_TEMP)) {
-		heater_driver__set_output_on();
-		on_periods--;					// decrease the on-duration before next temp measurement happens
-		heater_power_history++;
-	} else {
-		heater_driver__set_output_off(); 							// Turn heater OFF
-		timer_start_tip_measure_delay();					// Start TIM7 to read tip temperature
+	half_cycle_polarity ^= 1;
+
+	// Measurement half cycles alternate polarity, otherwise at high power every run of an odd length
+	// would heat one polarity more. If needed the run is extended by one heating half cycle.
+	if (((heating_slot >= heating_run_length)
+			&& ((half_cycle_polarity != measurement_polarity) || (heating_run_length >= MAX_ON_PERIODS)))
+			|| (heating_slot >= MAX_ON_PERIODS)) {
+		// Measurement half cycle, the heater is always off
+		heater_stats_count(0, SET);
+		heating_slot = 0;
+		measurement_polarity = half_cycle_polarity;
+		heater_driver__set_output_off(); 			// Turn heater OFF
+		timer_start_tip_measure_delay();			// Start TIM7 to read tip temperature
+		return;
+	}
+	heating_slot++;
+
+	if (heater_mode == HEATER_MODE_PHASE) {
+		heater_phase_control();
+		return;
+	}
+
+	// First order sigma-delta modulator: a heating half cycle is switched on every time the
+	// accumulated power demand reaches one full half cycle. This spreads any power evenly.
+	// A half cycle that would push the polarity balance beyond POLARITY_BALANCE_MAX is deferred,
+	// its demand stays in the accumulator for the next half cycle (opposite polarity).
+	sigma_delta_accumulator += heater_power;
+	if (heater_power == 0) {
+		sigma_delta_accumulator = 0;	// heater off or no demand, don't deliver deferred half cycles
+	} else if (sigma_delta_accumulator > SIGMA_DELTA_BACKLOG_MAX * PID_OUTPUT_MAX) {
+		sigma_delta_accumulator = SIGMA_DELTA_BACKLOG_MAX * PID_OUTPUT_MAX;
+	}
+	int8_t polarity_step = half_cycle_polarity ? 1 : -1;
+	if ((sigma_delta_accumulator >= PID_OUTPUT_MAX) && ((polarity_balance * polarity_step) < POLARITY_BALANCE_MAX)) {
+		sigma_delta_accumulator -= PID_OUTPUT_MAX;
+		if ((get_tip_temp() < MAX_TEMP) && (get_tip_temp_estimate() < MAX_TEMP)) {
+			heater_driver__set_output_on();
+			polarity_balance += polarity_step;
+			heater_power_history++;
+			heater_energy = ESTIMATOR_HEATER_ON;
+			heater_stats_count(heater_energy, RESET);
+			return;
+		}
 	}
+	heater_driver__set_output_off();
+	heater_stats_count(0, RESET);
+}
+
+// Called by the phase control timeout (TIM6) within a heating half cycle
+OPENSOLDER_RAMFUNC void heater_phase_off_timer_handler(void) {
+	heater_driver__set_output_off();
+}
+
+OPENSOLDER_RAMFUNC static void heater_phase_control(void) {
+	// Trailing edge phase control: every heating half cycle is switched on at the true zero cross and
+	// off again after the on time that delivers heater_power. Both polarities get the same on time.
+	uint16_t power = heater_power;
+	if ((power == 0) || (get_tip_temp() >= MAX_TEMP) || (get_tip_temp_estimate() >= MAX_TEMP)) {
+		heater_driver__set_output_off();
+		heater_stats_count(0, RESET);
+		return;
+	}
+
+	uint16_t half_cycle_us = get_ac_half_cycle_us();
+	uint16_t on_time_us = ((uint32_t)heater_phase_on_time(power) * half_cycle_us) >> 15;
+	heater_driver__set_output_on();
+	if (on_time_us < half_cycle_us - HEATER_PHASE_MIN_OFF_US) {
+		timer_start_phase_off_timeout(on_time_us);
+	}	// else the heater stays on for the whole half cycle, the next zero cross decides
+	heater_power_history++;
+	heater_energy = power >> (15 - ESTIMATOR_HEATER_SHIFT);
+	heater_stats_count(heater_energy, RESET);
+}
+
+static uint16_t heater_phase_on_time(uint16_t power) {
+	// Q15 power to Q15 on time, linear interpolation in heater_phase_table
+	uint8_t index = power >> HEATER_PHASE_TABLE_SHIFT;
+	uint16_t fraction = power & ((1 << HEATER_PHASE_TABLE_SHIFT) - 1);
+	uint16_t on_time = heater_phase_table[index];
+	return on_time + (((uint32_t)(heater_phase_table[index + 1] - on_time) * fraction) >> HEATER_PHASE_TABLE_SHIFT);
 }
 
 void heater_control(void) {
 	/*
-	 * Decide if power should be delivered to tip next half period, and
-	 * how many periods until next temp read (how much power to apply).
+	 * Decide how much power should be delivered to the tip until the next temp read.
 	 *
-	 * Full power is one read period (OFF) per 4 power periods (ON).
-	 * Number of power periods before next read period decreases as
-	 * temperature closes in on set_temp to prevent too much overshoot.
+	 * A run of heating half cycles is followed by one read half cycle (OFF). The run is long
+	 * far from the set temp (more power, faster heat up) and short close to it (more readings,
+	 * tighter control). The PID output (Q15, 0 to full power) is the share of heating half
+	 * cycles that are switched on, spread by the sigma-delta modulator in heater_control_timer_handler().
 	 */
 
 	uint16_t tmp_set_temp = set_temp;
@@ -47,22 +170,83 @@ void heater_control(void) {
 		tmp_set_temp = STANDBY_TEMP;
 	}
 
-	// Turn heater ON/OFF
-	if ((get_tip_temp() + 3) < tmp_set_temp) {		/// TODO: 3°C fixed hysteresis
-		uint16_t temperature_error = tmp_set_temp - get_tip_temp();
-		on_periods = temperature_error / 10;// regulator assumption: temperature_set - temperature_is / 10 = half waves to stay on
-		if (on_periods > MAX_ON_PERIODS) {
-			on_periods = MAX_ON_PERIODS;
-		} else if (on_periods == 0) {
-			on_periods = 1;
+	// Time since the last regulator run. Unknown after the heater was off, so don't integrate over it
+	uint16_t dt_ms = ((uint32_t)half_cycles_since_sample * get_ac_half_cycle_us()) / 1000;
+	half_cycles_since_sample = 0;
+	if (!regulator_active) {
+		pid_reset(&tip_pid);
+		regulator_active = SET;
+		dt_ms = 0;
+	}
+
+	int32_t power;
+	if (get_system_state() == AUTOTUNE_STATE) {
+		power = 0;	// stay off after the auto-tune finished, until the state machine leaves AUTOTUNE_STATE
+		if (get_autotune_state() == AUTOTUNE_RUNNING) {
+			power = autotune_update(&tip_autotune, get_tip_temp_estimate(), dt_ms);
+			if (get_autotune_state() == AUTOTUNE_DONE) {
+				int32_t kp, ki, kd;
+				autotune_get_gains(&tip_autotune, &kp, &ki, &kd);
+				pid_set_gains(&tip_pid, kp, ki, kd);
+				regulator_active = RESET;	// start the PID with the new gains from a clean state
+			}
 		}
 	} else {
-		on_periods = 0;	// disable on next interrupt
+		power = pid_update(&tip_pid, tmp_set_temp, get_tip_temp_estimate(), dt_ms);
+	}
+	heating_run_length = heater_select_run_length(get_tip_temp_estimate(), tmp_set_temp);
+	heater_power = power;
+}
+
+static uint8_t heater_select_run_length(int16_t tip_temp, int16_t target_temp) {
+	// Scale the heating run linearly with the distance to the target, bounded by MIN_ON_PERIODS and MAX_ON_PERIODS
+	int16_t distance = target_temp - tip_temp;
+	if (distance < 0) {
+		distance = -distance;
+	}
+	if (distance >= ON_PERIODS_TEMP_BAND) {
+		return MAX_ON_PERIODS;
+	}
+	return MIN_ON_PERIODS + (distance * (MAX_ON_PERIODS - MIN_ON_PERIODS)) / ON_PERIODS_TEMP_BAND;
+}
+
+static void heater_stats_count(uint16_t energy, uint8_t measurement) {
+	// Count AC half cycles over a window to report the effective duty and measurement rate
+	stats_half_cycles++;
+	stats_on_energy += energy;
+	stats_measurements += measurement;
+	if (stats_half_cycles >= HEATER_STATS_WINDOW) {
+		heater_duty_percent = ((uint32_t)stats_on_energy * 100) / ((uint32_t)HEATER_STATS_WINDOW * ESTIMATOR_HEATER_ON);
+		measurement_rate_hz = ((uint32_t)stats_measurements * 1000000) / ((uint32_t)HEATER_STATS_WINDOW * get_ac_half_cycle_us());
+		stats_half_cycles = 0;
+		stats_on_energy = 0;
+		stats_measurements = 0;
 	}
 }
 
 void set_tip_heater_off(void) {
-	on_periods = 0;
+	heater_power = 0;
+	regulator_active = RESET;
+	heating_run_length = MIN_ON_PERIODS;	// read soon after the heater is enabled again
+}
+
+void set_heater_power_percent(uint8_t percent) {
+	if (percent > 100) {
+		percent = 100;
+	}
+	heater_power = ((uint32_t)percent * PID_OUTPUT_MAX) / 100;
+}
+
+void heater_start_autotune(void) {
+	// Relay between no power and full power around set_temp. Gains are applied when done
+	autotune_start(&tip_autotune, set_temp, AUTOTUNE_HYSTERESIS, 0, PID_OUTPUT_MAX, AUTOTUNE_CYCLES, AUTOTUNE_TIMEOUT_MS);
+	regulator_active = RESET;
+}
+
+void heater_stop_autotune(void) {
+	if (autotune_get_state(&tip_autotune) == AUTOTUNE_RUNNING) {
+		autotune_stop(&tip_autotune);
+	}
 }
 
 void set_new_temp(uint16_t new_temp) {
@@ -84,6 +268,26 @@ void error_handler(void) {
 	set_tip_error_halt();
 }
 
-uint8_t get_power_bar_value(void) {
-	return power_bar_value;
+uint8_t get_autotune_state(void) {
+	return autotune_get_state(&tip_autotune);
+}
+
+uint8_t get_heater_duty_percent(void) {
+	return heater_duty_percent;
+}
+
+uint16_t get_measurement_rate_hz(void) {
+	return measurement_rate_hz;
+}
+
+void set_heater_mode(uint8_t mode) {
+	heater_mode = mode;
+}
+
+uint8_t get_heater_mode(void) {
+	return heater_mode;
+}
+
+uint8_t get_heater_power_percent(void) {
+	return ((uint32_t)heater_power * 100 + (PID_OUTPUT_MAX / 2)) >> 15;
 }
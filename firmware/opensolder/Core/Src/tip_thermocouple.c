@@ -21,37 +21,93 @@
  * PA1	= TIP_CHECK
  * PA2	= TIP_CLAMP
  *
- * 4. HAL_ADC_ConvCpltCallback() calls adc_complete() when the ADC conversion is done
+ * 4. TIM15 triggers ADC_BUFFER_LENGTH conversions in hardware, the DMA writes them into one half of adc_buffer.
+ *    start_adc() restarts the DMA at adc_buffer[0] first if a lost or extra conversion moved it off a half boundary
+ * 5. The DMA half / transfer complete interrupt (tip_adc_dma_irq_handler()) calls adc_complete() with the
+ *    completed half, the next measurement fills the other half
+ * 6. adc_complete() converts the reading and pends PendSV, the estimator update and heater_control() run
+ *    in tip_regulator_pendsv_handler() at the lowest interrupt priority
+ * The estimator predictions of the zero cross interrupt are queued to PendSV as well, so the estimator
+ * is only ever touched from PendSV and needs no interrupt lock
  *
  * The reason for these delays are to delay the ADC reading until the thermocouple amplifier
  * and low-pass filter have reached steady state.
  */
 
 #include <tip_thermocouple.h>
+#include "estimator.h"
+#include "thermocouple_table.h"
 
 /******    Local Function Declarations    ******/
 static void start_adc(void);
-static void adc_complete(void);
-static void adc_calculate_buffer_average(void);
+static void adc_resync(void);
+static void adc_stop(void);
+static void adc_complete(const uint16_t *buffer);
+static void adc_process_buffer(const uint16_t *buffer);
 static void adc_to_temperature(void);
-static void adc_deviation_check(void);
+static uint16_t thermocouple_table_lookup(uint32_t counts);
+static uint32_t thermocouple_table_reverse_lookup(uint16_t temp);
+static int32_t cold_junction_counts(void);
+static void adc_watchdog_update_threshold(void);
+static void adc_watchdog_apply_threshold(void);
+static void tip_publish_state(void);
 
 void thermocouple_error_handler(void);
 
+/******    Local Constants and Objects    ******/
+enum adc_buffer_constants {
+	ADC_TRIMMED_LENGTH = ADC_BUFFER_LENGTH - 2,		// the lowest and highest sample are not part of the trimmed mean
+	ADC_TRIMMED_MEAN_SHIFT = 18,
+	ADC_TRIMMED_MEAN_RECIPROCAL = ((1 << ADC_TRIMMED_MEAN_SHIFT) + ADC_TRIMMED_LENGTH / 2) / ADC_TRIMMED_LENGTH	// replaces the division, evaluated at compile time
+};
+_Static_assert((ADC_BUFFER_LENGTH % 2) == 0, "adc_process_buffer() is unrolled by two");
+
+typedef struct {
+	uint32_t sum;
+	uint16_t min;
+	uint16_t min2;		// second lowest sample
+	uint16_t max;
+	uint16_t max2;		// second highest sample
+} adc_buffer_statistics;
+
 /******    File Scope Variables    ******/
-static uint16_t adc_buffer[ADC_BUFFER_LENGTH];
-static uint32_t adc_buffer_average = 0;
+static uint16_t adc_buffer[2][ADC_BUFFER_LENGTH];	// circular DMA double buffer, one half per measurement
+static uint32_t adc_buffer_average = 0;		// trimmed mean of the last completed adc_buffer half
+static uint8_t adc_buffer_noisy = RESET;		// SET if more than one sample per side deviates from the mean
+static isr_stats adc_isr_stats;					// duration of the ADC DMA interrupt (buffer processing), µs
 static uint8_t adc_current_measurement = ADC_MEASURE_TEMPERATURE;
 
 static uint16_t tip_temp = 0;
+static int16_t cold_junction_temp = TIP_AMBIENT_TEMP;
+static estimator tip_estimator;
 
 static volatile uint16_t tip_state = TIP_NOT_DETECTED;
+static uint16_t published_tip_state = TIP_NOT_DETECTED;	// last tip_state sent to the state machine
+static event_queue tip_events;		// ADC DMA interrupt to the state machine
+static event_queue estimator_events;	// heater energy per half cycle, zero cross interrupt to PendSV
+static volatile uint8_t reading_pending = RESET;	// a new reading waits for the estimator update in PendSV
 static volatile uint16_t tip_check_counter = 0;
 static volatile uint8_t tip_timer_delay_flag = SET;
 
 static volatile uint8_t error_flag = RESET;
+static volatile uint8_t adc_watchdog_tripped = RESET;	// SET if the analog watchdog tripped during the current measurement
+static volatile uint32_t adc_watchdog_threshold = 0;	// TR value for the current cold junction, pending while it differs from TR
 
 
+void tip_thermocouple_init(void) {
+	// The ADC waits for TIM15 triggers from now on, the DMA wraps around adc_buffer forever.
+	// TIM15 runs ADC_BUFFER_LENGTH periods per start (repetition counter), one conversion each
+	htim15.Instance->RCR = ADC_BUFFER_LENGTH - 1;
+	htim15.Instance->EGR = TIM_EGR_UG;
+	isr_stats_reset(&adc_isr_stats);
+	event_queue_init(&tip_events);
+	event_queue_init(&estimator_events);
+	adc_watchdog_update_threshold();
+	hadc.Instance->TR = adc_watchdog_threshold;		// the ADC is not started yet
+	HAL_ADC_Start_DMA(&hadc, (uint32_t*) adc_buffer, (sizeof(adc_buffer) / sizeof(uint16_t)));
+
+	estimator_init(&tip_estimator, ESTIMATOR_HEAT_RATE, ESTIMATOR_COOLING_TIME_MS, ESTIMATOR_PROCESS_NOISE, ESTIMATOR_MEASUREMENT_NOISE, TIP_AMBIENT_TEMP);
+}
 
 void tip_timer_handler(void) {
 	/*
@@ -64,11 +120,14 @@ void tip_timer_handler(void) {
 	if (tip_timer_delay_flag == SET) {
 		tip_timer_delay_flag = RESET;
 
-		heater_driver__set_state(NOK);		// dis-allow the heater to be turned on (NOK = not ok to enable the heater)
+		if (heater_driver__get_state() != FORBIDDEN) {
+			heater_driver__set_state(NOK);		// dis-allow the heater to be turned on (NOK = not ok to enable the heater)
+		}
 		heater_driver__set_output_off();	// hard-disable the heater output to protect the op-amp
 		tip_clamp_pin_disable();	// Set TIP_CLAMP pin to input state (high impedance)
+		adc_watchdog_apply_threshold();	// no measurement runs until start_adc()
 
-		if (tip_check_counter > (TIP_CHECK_INTERVAL * 50)) {
+		if (tip_check_counter >= get_ac_half_cycles(TIP_CHECK_INTERVAL_MS)) {
 			adc_current_measurement = ADC_CHECK_TIP_AVAILABLE;
 			tip_check_pin_enable(); // Drive TIP_CHECK pin HIGH, if no tip is inserted the op-amp will saturate and ADC will read close to 4096.
 			tip_check_counter = 0;
@@ -76,7 +135,7 @@ void tip_timer_handler(void) {
 	} else { 							// Second period of TIM7, 4ms after true zero cross and disabling the power
 		tip_timer_delay_flag = SET;
 		timer_stop_tip_measure_delay(); // Stop TIM7
-		start_adc();				  	// Start ADC conversion in DMA mode
+		start_adc();				  	// Start the hardware triggered ADC conversions
 	}
 }
 
@@ -85,66 +144,244 @@ void tip_check_counter_increase(void){
 }
 
 
-void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
-	tip_clamp_pin_enable();	// Drive TIP_CHECK pin LOW, this clamps thermo-couple signal to prevent transients and noise on the op-amp input
-	heater_driver__set_state(OK);	// adc completed, allow the heater to be enabled again
-	adc_complete();
+// DMA1 channel 1 fast path, called first from the IRQ handler in stm32f0xx_it.c. Replaces the HAL ADC conversion
+// callbacks, transfer errors are left to the HAL handler (returns RESET)
+OPENSOLDER_RAMFUNC uint8_t tip_adc_dma_irq_handler(void) {
+	uint32_t flags = DMA1->ISR;
+	if (flags & DMA_ISR_TEIF1) {
+		return RESET;
+	}
+	uint16_t entry = TIM17->CNT;
+	if (flags & DMA_ISR_HTIF1) {
+		DMA1->IFCR = DMA_IFCR_CHTIF1;
+		adc_complete(adc_buffer[0]);
+	}
+	if (flags & DMA_ISR_TCIF1) {
+		DMA1->IFCR = DMA_IFCR_CTCIF1;
+		adc_complete(adc_buffer[1]);
+	}
+	tip_publish_state();
+	isr_stats_record(&adc_isr_stats, TIM17->CNT - entry);
+	return SET;
+}
+
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc) {
+	/*
+	 * Analog watchdog: a single conversion above the threshold (tip over ABS_MAX_TEMP or no tip, amplifier saturated)
+	 * kills the heater right away, without waiting for the end of the measurement or the main loop.
+	 * The heater stays FORBIDDEN until a tip check finds a tip again without tripping the watchdog.
+	 */
+	UNUSED(hadc);
+	adc_watchdog_tripped = SET;
+	heater_driver__set_state(FORBIDDEN);
+	set_tip_error_halt();
+	tip_state = TIP_NOT_DETECTED;
+}
+
+static void tip_publish_state(void) {
+	// Changes by the analog watchdog are sent at the end of the measurement it tripped in, the DMA interrupt is the only producer.
+	// A change that doesn't fit into the queue is sent again after the next measurement
+	uint16_t state = tip_state;
+	if ((state != published_tip_state) && event_queue_push(&tip_events, EVENT_TIP_STATE, state)) {
+		published_tip_state = state;
+	}
 }
 
 static void start_adc(void) {
-	HAL_ADC_Start_DMA(&hadc, (uint32_t*) adc_buffer,
-			(sizeof(adc_buffer) / sizeof(uint16_t)));
+	// TIM15 one pulse mode: the conversions are paced by hardware and the timer stops by itself after the last one
+	adc_watchdog_tripped = RESET;
+	adc_resync();
+	__HAL_TIM_ENABLE(&htim15);
 }
 
-static void adc_complete(void) {
-	adc_calculate_buffer_average();
+static void adc_resync(void) {
+	/*
+	 * Nothing in the circular DMA marks the measurement a sample belongs to: a lost or extra conversion would split
+	 * every following measurement across both halves of adc_buffer. The previous measurement is complete here,
+	 * so the DMA has to sit at a half boundary. An overrun blocks the DMA requests until OVR is cleared.
+	 */
+	uint32_t remaining = DMA1_Channel1->CNDTR;
+	if (((remaining == ADC_BUFFER_LENGTH) || (remaining == 2 * ADC_BUFFER_LENGTH))
+			&& !(hadc.Instance->ISR & ADC_ISR_OVR)) {
+		return;
+	}
+	adc_stop();
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+	DMA1_Channel1->CNDTR = 2 * ADC_BUFFER_LENGTH;	// the next measurement fills adc_buffer[0]
+	DMA1->IFCR = DMA_IFCR_CGIF1;	// flags of the broken measurement
+	DMA1_Channel1->CCR |= DMA_CCR_EN;
+	hadc.Instance->ISR = ADC_ISR_OVR;
+	hadc.Instance->CR |= ADC_CR_ADSTART;	// wait for TIM15 triggers again
+}
+
+static void adc_stop(void) {
+	// ADSTP ends the wait for triggers, the ADC clears ADSTART once it has stopped
+	if (hadc.Instance->CR & ADC_CR_ADSTART) {
+		hadc.Instance->CR |= ADC_CR_ADSTP;
+		while (hadc.Instance->CR & ADC_CR_ADSTART) {
+		}
+	}
+}
+
+static void adc_complete(const uint16_t *buffer) {
+	tip_clamp_pin_enable();	// Drive TIP_CHECK pin LOW, this clamps thermo-couple signal to prevent transients and noise on the op-amp input
+	if (heater_driver__get_state() != FORBIDDEN) {
+		heater_driver__set_state(OK);	// adc completed, allow the heater to be enabled again
+	}
+	adc_process_buffer(buffer);
 	if (adc_current_measurement == ADC_CHECK_TIP_AVAILABLE) {
 		adc_current_measurement = ADC_CHECK_TIP_AVAILABLE_WAIT;
 		tip_check_pin_disable();
-		tip_state = tip_check();
+		// A watchdog trip during this measurement keeps its TIP_NOT_DETECTED, the trimmed mean could still pass the check
+		if (adc_watchdog_tripped == RESET) {
+			tip_state = tip_check();
+			if (tip_state == TIP_DETECTED) {
+				heater_driver__set_state(OK);	// tip is back (or cooled down), release an analog watchdog trip
+			}
+		}
+	} else if (adc_current_measurement == ADC_CHECK_TIP_AVAILABLE_WAIT) {
+		adc_current_measurement = ADC_MEASURE_TEMPERATURE;	// the amplifier recovers from the tip check saturation, skip this reading
 	} else if ((adc_current_measurement == ADC_MEASURE_TEMPERATURE) && (tip_state == TIP_DETECTED)) {
 		adc_to_temperature();
-		adc_deviation_check();
+		if (adc_buffer_noisy == SET) {
+			error_flag = SET;
+		}
 		if (error_flag == SET) {
 			tip_temp = ADC_READING_ERROR;
 			thermocouple_error_handler();
-		} else if ((get_system_state() == ON_STATE)
-				|| (get_system_state() == STANDBY_STATE)) {
-			heater_control();
+			return;
 		}
+		reading_pending = SET;
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;	// the regulator runs in tip_regulator_pendsv_handler()
+	}
+}
+
+// PendSV, lowest priority: the estimator and the regulator work of a new reading, deferred from the zero cross
+// and ADC DMA interrupts so they are never held up by it. The estimator has no other user, so it needs no lock
+// and the analog watchdog is never masked
+void tip_regulator_pendsv_handler(void) {
+	// Whole ms per half cycle, the remainder is carried over (60Hz: 8, 8, 9ms...)
+	static uint16_t remainder_us = 0;
+	event half_cycle;
+	while (event_queue_pop(&estimator_events, &half_cycle)) {
+		uint16_t elapsed_us = remainder_us + get_ac_half_cycle_us();
+		remainder_us = elapsed_us % 1000;
+		estimator_predict(&tip_estimator, half_cycle.value, elapsed_us / 1000);
+	}
+
+	if (reading_pending == RESET) {
+		return;
+	}
+	reading_pending = RESET;
+	estimator_update(&tip_estimator, tip_temp);
+	if ((get_system_state() == ON_STATE)
+			|| (get_system_state() == STANDBY_STATE)
+			|| (get_system_state() == AUTOTUNE_STATE)) {
+		heater_control();
 	}
 }
 
 static void adc_to_temperature(void) {
-	// Calculate tip temperature in Celsius
-	tip_temp = (adc_buffer_average * 100 / 750) + 25;
+	// Calculate tip temperature in Celsius. The table is referenced to 0°C, add the cold junction EMF first
+	int32_t counts = adc_buffer_average + cold_junction_counts();
+	if (counts < 0) {
+		counts = 0;
+	}
+	tip_temp = thermocouple_table_lookup(counts);
 }
 
-static void adc_calculate_buffer_average(void) {
-	// Calculate the average value of adc_buffer
-	adc_buffer_average = 0;
-	for (uint16_t i = 0; i < ADC_BUFFER_LENGTH; i++) {
-		adc_buffer_average += adc_buffer[i];
+static int32_t cold_junction_counts(void) {
+	return (cold_junction_temp * THERMOCOUPLE_COLD_JUNCTION_SLOPE) >> THERMOCOUPLE_COLD_JUNCTION_SHIFT;
+}
+
+static void adc_watchdog_update_threshold(void) {
+	// ADC reading at ABS_MAX_TEMP for the current cold junction, but never above the no tip (saturated amplifier) level
+	int32_t threshold = thermocouple_table_reverse_lookup(ABS_MAX_TEMP) - cold_junction_counts();
+	if (threshold > ADC_NO_TIP_MIN_VALUE) {
+		threshold = ADC_NO_TIP_MIN_VALUE;
 	}
-	adc_buffer_average /= ADC_BUFFER_LENGTH;
+	// TR must not be written while ADSTART is set, adc_watchdog_apply_threshold() writes it between two measurements.
+	// The low threshold stays 0
+	adc_watchdog_threshold = ADC_TRX_HIGHTHRESHOLD(threshold);
 }
 
-static void adc_deviation_check(void) {
-	// Check if any values in adc_buffer deviates more than expected, if so set error_flag
-	int16_t upper_limit = adc_buffer_average + ADC_MAX_DEVIATION;
-	int16_t lower_limit = adc_buffer_average - ADC_MAX_DEVIATION;
+static void adc_watchdog_apply_threshold(void) {
+	// Stop the ADC, write the pending threshold and wait for TIM15 triggers again
+	uint32_t threshold = adc_watchdog_threshold;
+	if (hadc.Instance->TR == threshold) {
+		return;
+	}
+	adc_stop();
+	hadc.Instance->TR = threshold;
+	hadc.Instance->CR |= ADC_CR_ADSTART;
+}
 
-	for (uint16_t i = 0; i < ADC_BUFFER_LENGTH; i++) {
-		if ((adc_buffer[i] > upper_limit) || (adc_buffer[i] < lower_limit)) {
-			error_flag = SET;
+static uint16_t thermocouple_table_lookup(uint32_t counts) {
+	// Piecewise linear interpolation between two table entries, constant time and no division
+	uint32_t index = counts >> THERMOCOUPLE_TABLE_SEGMENT_SHIFT;
+	if (index >= THERMOCOUPLE_TABLE_LENGTH - 1) {
+		return thermocouple_table[THERMOCOUPLE_TABLE_LENGTH - 1] >> THERMOCOUPLE_TABLE_TEMP_SHIFT;
+	}
+	uint32_t fraction = counts & ((1 << THERMOCOUPLE_TABLE_SEGMENT_SHIFT) - 1);
+	uint32_t value = thermocouple_table[index]
+			+ (((thermocouple_table[index + 1] - thermocouple_table[index]) * fraction) >> THERMOCOUPLE_TABLE_SEGMENT_SHIFT);
+	return (value + (1 << (THERMOCOUPLE_TABLE_TEMP_SHIFT - 1))) >> THERMOCOUPLE_TABLE_TEMP_SHIFT;
+}
+
+static uint32_t thermocouple_table_reverse_lookup(uint16_t temp) {
+	// ADC counts (0°C cold junction) of a temperature, the inverse of thermocouple_table_lookup(). Not for interrupts, it divides
+	uint32_t value = (uint32_t)temp << THERMOCOUPLE_TABLE_TEMP_SHIFT;
+	for (uint16_t i = 1; i < THERMOCOUPLE_TABLE_LENGTH; i++) {
+		if (thermocouple_table[i] >= value) {
+			return ((i - 1) << THERMOCOUPLE_TABLE_SEGMENT_SHIFT)
+					+ ((value - thermocouple_table[i - 1]) << THERMOCOUPLE_TABLE_SEGMENT_SHIFT) / (thermocouple_table[i] - thermocouple_table[i - 1]);
 		}
 	}
+	return UINT16_MAX;	// beyond the table
+}
+
+static inline void adc_statistics_add(adc_buffer_statistics *const stats, uint16_t sample) {
+	stats->sum += sample;
+	if (sample < stats->min) {
+		stats->min2 = stats->min;
+		stats->min = sample;
+	} else if (sample < stats->min2) {
+		stats->min2 = sample;
+	}
+	if (sample > stats->max) {
+		stats->max2 = stats->max;
+		stats->max = sample;
+	} else if (sample > stats->max2) {
+		stats->max2 = sample;
+	}
+}
+
+static void adc_process_buffer(const uint16_t *buffer) {
+	/*
+	 * One pass over the buffer: sum, the two lowest and the two highest samples.
+	 * The lowest and highest sample are dropped from the mean, so a single noisy sample per side
+	 * does not spoil the reading. The reading is only flagged noisy if the second lowest or second
+	 * highest sample still deviates more than ADC_MAX_DEVIATION from the trimmed mean.
+	 */
+	adc_buffer_statistics stats = { 0, UINT16_MAX, UINT16_MAX, 0, 0 };
+
+	for (uint16_t i = 0; i < ADC_BUFFER_LENGTH; i += 2) {
+		adc_statistics_add(&stats, buffer[i]);
+		adc_statistics_add(&stats, buffer[i + 1]);
+	}
+
+	adc_buffer_average = ((stats.sum - stats.min - stats.max) * ADC_TRIMMED_MEAN_RECIPROCAL + (1 << (ADC_TRIMMED_MEAN_SHIFT - 1))) >> ADC_TRIMMED_MEAN_SHIFT;
+
+	adc_buffer_noisy = RESET;
+	if ((stats.max2 > adc_buffer_average + ADC_MAX_DEVIATION) || ((uint32_t)stats.min2 + ADC_MAX_DEVIATION < adc_buffer_average)) {
+		adc_buffer_noisy = SET;
+	}
 }
 
 uint8_t tip_check(void) {
 	/*
 	 * - TIP CHECK -
-	 * 1. tip_check_flag is set every TIP_CHECK_INTERVAL AC half cycles, and TIP_CHECK_PIN is pulled high
+	 * 1. tip_check_flag is set every TIP_CHECK_INTERVAL_MS (counted in AC half cycles), and TIP_CHECK_PIN is pulled high
 	 * 2. When ADC is finished, adc_complete() reset TIP_CHECK_PIN,
 	 *    calculates the average value of the ADC buffer reading and calls tip_check() to update tip_state
 	 */
@@ -162,10 +399,49 @@ uint16_t get_tip_temp(void) {
 	return tip_temp;
 }
 
+uint16_t get_tip_temp_estimate(void) {
+	return estimator_get_temperature(&tip_estimator);
+}
+
+uint8_t get_tip_temp_estimate_valid(void) {
+	return estimator_is_initialized(&tip_estimator) ? SET : RESET;
+}
+
+void set_cold_junction_temp(int16_t temp) {
+	// The thermocouple connector sits on the PCB, the PCT2075 reading is the cold junction temperature
+	if ((temp < PCB_TEMP_MIN) || (temp > PCB_TEMP_MAX)) {
+		return;		// read error or implausible, keep the previous value
+	}
+	if (temp == cold_junction_temp) {
+		return;
+	}
+	cold_junction_temp = temp;
+	estimator_set_ambient(&tip_estimator, temp);
+	adc_watchdog_update_threshold();
+}
+
+void tip_temp_estimator_predict(uint16_t heater_energy) {
+	// The prediction runs in tip_regulator_pendsv_handler(), the zero cross interrupt only queues the half cycle
+	event_queue_push(&estimator_events, EVENT_HEATER_ENERGY, heater_energy);
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+isr_stats *get_adc_isr_stats(void) {
+	return &adc_isr_stats;
+}
+
 uint8_t get_tip_state(void) {
 	return tip_state;
 }
 
+event_queue *get_tip_events(void) {
+	return &tip_events;
+}
+
+event_queue *get_estimator_events(void) {
+	return &estimator_events;
+}
+
 void thermocouple_error_handler(void){
 	tip_state = TIP_CHECK_ERROR;
 	error_flag = RESET;
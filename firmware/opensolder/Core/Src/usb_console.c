@@ -0,0 +1,170 @@
+/*
+ * usb_console.c
+ *
+ * Text commands over the USB CDC (virtual COM) port. Commands are collected in the USB interrupt
+ * and executed from the main loop, answers are sent one line per pass so the loop never waits for the host.
+ */
+
+#include "usb_console.h"
+#include "usbd_cdc_if.h"
+#include "timers.h"
+#include <tip_thermocouple.h>
+#include "hid.h"
+#include <string.h>
+#include <stdio.h>
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+enum usb_console_commands {
+	USB_CONSOLE_NONE = 0,
+	USB_CONSOLE_ISR_REPORT,
+	USB_CONSOLE_ISR_RESET,
+	USB_CONSOLE_TASK_REPORT,
+	USB_CONSOLE_TASK_RESET
+};
+
+static char rx_line[USB_CONSOLE_LINE_LENGTH + 1];
+static uint8_t rx_length = 0;
+static volatile uint8_t pending_command = USB_CONSOLE_NONE;
+static char tx_line[USB_CONSOLE_TX_LENGTH];
+static uint8_t report_line = 0;		// next line of the running report
+static uint8_t report_active = USB_CONSOLE_NONE;	// report being sent, USB_CONSOLE_ISR_REPORT or USB_CONSOLE_TASK_REPORT
+
+static const char *const timer_isr_stats_names[TIMER_ISR_STATS_COUNT] = {
+	"edge_latency",
+	"edge_duration",
+	"zerocross_latency",
+	"zerocross_duration",
+	"heater_switch_latency",
+	"tip_timer_latency",
+	"tip_timer_duration"
+};
+
+/******    Local Function Declarations    ******/
+static void usb_console_parse(void);
+static uint8_t usb_console_send_report_line(void);
+static uint8_t usb_console_send_task_line(void);
+static uint8_t usb_console_tx_free(void);
+static uint8_t usb_console_transmit(int length);
+
+// --- handlers ---
+void usb_console__receive(const uint8_t *buffer, uint32_t length) {
+	for (uint32_t i = 0; i < length; i++) {
+		if ((buffer[i] == '\r') || (buffer[i] == '\n')) {
+			rx_line[rx_length] = '\0';
+			usb_console_parse();
+			rx_length = 0;
+		} else if (rx_length < USB_CONSOLE_LINE_LENGTH) {
+			rx_line[rx_length++] = buffer[i];
+		}
+	}
+}
+
+void usb_console__poll(void) {
+	uint8_t command = pending_command;
+	pending_command = USB_CONSOLE_NONE;
+
+	if (command == USB_CONSOLE_ISR_RESET) {
+		// The statistics are written from the interrupts, the reset retries instead of masking them
+		for (uint8_t i = 0; i < TIMER_ISR_STATS_COUNT; i++) {
+			isr_stats_reset(get_timer_isr_stats(i));
+		}
+		isr_stats_reset(get_adc_isr_stats());
+	} else if (command == USB_CONSOLE_TASK_RESET) {
+		scheduler_reset_stats(get_scheduler(), HAL_GetTick());
+	} else if ((command == USB_CONSOLE_ISR_REPORT) || (command == USB_CONSOLE_TASK_REPORT)) {
+		report_line = 0;
+		report_active = command;
+	}
+
+	if (report_active == USB_CONSOLE_ISR_REPORT) {
+		report_active = usb_console_send_report_line() ? USB_CONSOLE_ISR_REPORT : USB_CONSOLE_NONE;
+	} else if (report_active == USB_CONSOLE_TASK_REPORT) {
+		report_active = usb_console_send_task_line() ? USB_CONSOLE_TASK_REPORT : USB_CONSOLE_NONE;
+	}
+}
+
+static void usb_console_parse(void) {
+	if (strcmp(rx_line, "isr") == 0) {
+		pending_command = USB_CONSOLE_ISR_REPORT;
+	} else if (strcmp(rx_line, "isr reset") == 0) {
+		pending_command = USB_CONSOLE_ISR_RESET;
+	} else if (strcmp(rx_line, "tasks") == 0) {
+		pending_command = USB_CONSOLE_TASK_REPORT;
+	} else if (strcmp(rx_line, "tasks reset") == 0) {
+		pending_command = USB_CONSOLE_TASK_RESET;
+	}
+}
+
+// Sends the next line of the report if the CDC endpoint is free. Returns SET while lines are left
+static uint8_t usb_console_send_report_line(void) {
+	if (!usb_console_tx_free()) {
+		return SET;		// tx_line is still being sent, try again next pass
+	}
+
+	if (report_line > TIMER_ISR_STATS_COUNT) {
+		// Events lost to a full queue, counted by the producer interrupts
+		if (!usb_console_transmit(snprintf(tx_line, sizeof(tx_line), "events_dropped hid=%u tip=%u estimator=%u\r\n",
+				event_queue_get_dropped(hid__get_events()), event_queue_get_dropped(get_tip_events()),
+				event_queue_get_dropped(get_estimator_events())))) {
+			return SET;		// try again next pass
+		}
+		return RESET;
+	}
+
+	isr_stats snapshot;
+	const char *name;
+	// The statistics are written from the interrupts, isr_stats_copy() retries instead of masking them
+	if (report_line < TIMER_ISR_STATS_COUNT) {
+		isr_stats_copy(get_timer_isr_stats(report_line), &snapshot);
+		name = timer_isr_stats_names[report_line];
+	} else {
+		isr_stats_copy(get_adc_isr_stats(), &snapshot);
+		name = "adc_duration";
+	}
+
+	if (!usb_console_transmit(isr_stats_format(&snapshot, name, tx_line, sizeof(tx_line)))) {
+		return SET;		// try again next pass
+	}
+
+	report_line++;
+	return SET;		// the ADC line follows the timer lines, the dropped events line the ADC line
+}
+
+// Task report: one line per scheduler task, then the load. Returns SET while lines are left
+static uint8_t usb_console_send_task_line(void) {
+	if (!usb_console_tx_free()) {
+		return SET;		// tx_line is still being sent, try again next pass
+	}
+
+	scheduler *tasks = get_scheduler();
+	uint8_t task_count = scheduler_get_task_count(tasks);
+	int length;
+	if (report_line < task_count) {
+		length = scheduler_format_task(tasks, report_line, tx_line, sizeof(tx_line));
+	} else {
+		uint16_t load = scheduler_get_load(tasks, HAL_GetTick());
+		length = snprintf(tx_line, sizeof(tx_line), "load %u%% idle %u%%\r\n", (load * 100) >> SCHEDULER_LOAD_SHIFT,
+				100 - ((load * 100) >> SCHEDULER_LOAD_SHIFT));
+	}
+	if (!usb_console_transmit(length)) {
+		return SET;		// try again next pass
+	}
+
+	report_line++;
+	return report_line <= task_count;	// the load line follows the task lines
+}
+
+// The previous line is sent from tx_line until the IN transfer completes, it must not be formatted before
+static uint8_t usb_console_tx_free(void) {
+	USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+	return (hcdc != NULL) && (hcdc->TxState == 0);
+}
+
+// Sends tx_line if the CDC endpoint is free. Returns RESET if it has to be sent again
+static uint8_t usb_console_transmit(int length) {
+	if (length >= (int)sizeof(tx_line)) {
+		length = sizeof(tx_line) - 1;
+	}
+	return (length > 0) && (CDC_Transmit_FS((uint8_t*)tx_line, length) != USBD_BUSY);
+}
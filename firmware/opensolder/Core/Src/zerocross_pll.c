@@ -0,0 +1,114 @@
+/*
+ * zerocross_pll.c
+ *
+ * Software phase-locked loop tracking the mains zero crossings from the optocoupler edges
+ */
+
+#include "zerocross_pll.h"
+
+/******    Local Function Declarations    ******/
+static uint8_t zerocross_pll_period_plausible(zerocross_pll *const self, uint32_t period);
+static void zerocross_pll_unlock(zerocross_pll *const self);
+static void zerocross_pll_correct(zerocross_pll *const self, uint16_t predicted, int16_t error);
+
+/******    functions    ******/
+void zerocross_pll_init(zerocross_pll *const self, uint16_t nominal_period_us, uint16_t offset_us) {
+	self->nominal_period = (uint32_t)nominal_period_us << ZEROCROSS_PLL_PERIOD_Q;
+	self->period = self->nominal_period;
+	self->offset_us = offset_us;
+	self->last_edge = 0;
+	self->last_raw_edge = 0;
+	zerocross_pll_unlock(self);
+}
+
+uint8_t zerocross_pll_edge(zerocross_pll *const self, uint16_t timestamp) {
+	if (!self->locked) {
+		// Acquisition: follow the raw edges, lock after enough plausible periods in a row
+		uint32_t measured = (uint32_t)(uint16_t)(timestamp - self->last_raw_edge) << ZEROCROSS_PLL_PERIOD_Q;
+		if (zerocross_pll_period_plausible(self, measured)) {
+			self->period = measured;
+			self->lock_count++;
+			if (self->lock_count >= ZEROCROSS_PLL_LOCK_EDGES) {
+				self->locked = 1;
+			}
+		} else {
+			self->lock_count = 0;
+		}
+		self->last_edge = timestamp;
+		self->last_raw_edge = timestamp;
+		return ZEROCROSS_PLL_ACCEPTED;
+	}
+
+	int16_t late = (int16_t)(timestamp - self->last_edge);
+	if ((self->coast_count > 0) && (late > 0) && (late < ZEROCROSS_PLL_WINDOW_US)) {
+		// The edge came after its zero cross was already coasted through: correct the PLL, nothing left to schedule
+		self->coast_count--;
+		zerocross_pll_correct(self, self->last_edge, late);
+		self->last_raw_edge = timestamp;
+		return ZEROCROSS_PLL_LATE;
+	}
+
+	uint16_t predicted = self->last_edge + (self->period >> ZEROCROSS_PLL_PERIOD_Q);
+	int16_t error = (int16_t)(timestamp - predicted);
+	if ((error > ZEROCROSS_PLL_WINDOW_US) || (error < -ZEROCROSS_PLL_WINDOW_US)) {
+		return ZEROCROSS_PLL_REJECTED;
+	}
+
+	zerocross_pll_correct(self, predicted, error);
+	self->last_raw_edge = timestamp;
+	self->coast_count = 0;
+	return ZEROCROSS_PLL_ACCEPTED;
+}
+
+uint8_t zerocross_pll_coast(zerocross_pll *const self) {
+	// A predicted zero cross passed without an edge, assume it happened as predicted
+	if (!self->locked) {
+		return 0;
+	}
+	self->last_edge += self->period >> ZEROCROSS_PLL_PERIOD_Q;
+	self->coast_count++;
+	if (self->coast_count > ZEROCROSS_PLL_MAX_COAST) {
+		zerocross_pll_unlock(self);
+	}
+	return self->locked;
+}
+
+uint16_t zerocross_pll_get_zero(zerocross_pll *const self) {
+	return self->last_edge + self->offset_us;
+}
+
+uint16_t zerocross_pll_get_next_zero(zerocross_pll *const self) {
+	return self->last_edge + (self->period >> ZEROCROSS_PLL_PERIOD_Q) + self->offset_us;
+}
+
+uint16_t zerocross_pll_get_period(zerocross_pll *const self) {
+	return self->period >> ZEROCROSS_PLL_PERIOD_Q;
+}
+
+void zerocross_pll_set_offset(zerocross_pll *const self, uint16_t offset_us) {
+	self->offset_us = offset_us;
+}
+
+uint8_t zerocross_pll_is_locked(zerocross_pll *const self) {
+	return self->locked;
+}
+
+static uint8_t zerocross_pll_period_plausible(zerocross_pll *const self, uint32_t period) {
+	uint32_t tolerance = (self->nominal_period * ZEROCROSS_PLL_TOLERANCE) / 100;
+	return (period > self->nominal_period - tolerance) && (period < self->nominal_period + tolerance);
+}
+
+static void zerocross_pll_correct(zerocross_pll *const self, uint16_t predicted, int16_t error) {
+	// Proportional phase and integral period correction, the period stays within the tolerance
+	self->last_edge = predicted + (error >> ZEROCROSS_PLL_PHASE_SHIFT);
+	int32_t period = (int32_t)self->period + (((int32_t)error * (1 << ZEROCROSS_PLL_PERIOD_Q)) >> ZEROCROSS_PLL_PERIOD_SHIFT);
+	if (zerocross_pll_period_plausible(self, period)) {
+		self->period = period;
+	}
+}
+
+static void zerocross_pll_unlock(zerocross_pll *const self) {
+	self->locked = 0;
+	self->lock_count = 0;
+	self->coast_count = 0;
+}
@@ -18,14 +18,15 @@ uint8_t heater_driver__get_state(void) {
 	return heater_driver__current_state;
 }
 
-void heater_driver__set_output_on(void) {
+// Called from the zero cross interrupts, the pin is written on register level (atomic set/reset)
+OPENSOLDER_RAMFUNC void heater_driver__set_output_on(void) {
 	if(heater_driver__current_state == OK) {	// if an error is present, the output is not allowed to turn on
-		HAL_GPIO_WritePin(HEATER_GPIO_Port, HEATER_Pin, ON); // Turn heater on
+		HEATER_GPIO_Port->BSRR = HEATER_Pin; // Turn heater on
 	} else {
 		heater_driver__set_output_off();	// Any other case turn the heater off
 	}
 }
-void heater_driver__set_output_off(void) {
-	HAL_GPIO_WritePin(HEATER_GPIO_Port, HEATER_Pin, OFF); // Turn heater off (ignores the forbidden flag, OFF can be a safety state)
+OPENSOLDER_RAMFUNC void heater_driver__set_output_off(void) {
+	HEATER_GPIO_Port->BRR = HEATER_Pin; // Turn heater off (ignores the forbidden flag, OFF can be a safety state)
 }
 
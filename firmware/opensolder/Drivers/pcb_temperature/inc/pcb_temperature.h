@@ -10,8 +10,12 @@
 
 #include "opensolder.h"
 
+// handlers
+void pcb_temperature_driver__poll(void);	// starts a non-blocking read, PCB_TEMP_READ_INTERVAL_MS task
+
 // getters
-int16_t pcb_temperature_driver__get_temperature(void);
+int16_t pcb_temperature_driver__get_temperature(void);		// blocking read, only used before the main loop runs
+int16_t pcb_temperature_driver__get_last_temperature(void);	// result of the last background read, ADC_READING_ERROR if none succeeded
 
 
 // setters
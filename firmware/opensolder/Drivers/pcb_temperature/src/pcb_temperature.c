@@ -2,19 +2,52 @@
  * pcb_temperature.c
  *
  * This lib implements pcb temperature related functionalities
+ *
+ * Background reads use the I2C interrupt mode: pcb_temperature_driver__poll() starts
+ * a transfer and HAL_I2C_MasterRxCpltCallback() stores the result, the main loop never waits for the bus.
  */
 
 #include "../inc/pcb_temperature.h"
 
+static int16_t pcb_temperature_decode(uint8_t *buffer);
+
+static uint8_t rx_buffer[2];
+static volatile int16_t last_temperature = ADC_READING_ERROR;
+
 int16_t pcb_temperature_driver__get_temperature(void) {
-	int16_t temp_register = 0;
 	uint8_t tmp_buffer[2];
 
 	if (HAL_I2C_Master_Receive(&hi2c1, PCT2075_I2C_ADDR, tmp_buffer, sizeof(tmp_buffer), 100) != HAL_ERROR) {
-		temp_register = (tmp_buffer[0] << 8);
-		temp_register |= tmp_buffer[1];
-		return ((temp_register >> 5) * 0.125); // Returns 11 bit signed (2s compl.) temperature in Celsius.
+		return pcb_temperature_decode(tmp_buffer);
 	} else {
 		return ADC_READING_ERROR;
 	}
 }
+
+void pcb_temperature_driver__poll(void) {
+	// The temperature register pointer is selected after power-up, so a plain read returns the temperature.
+	// If the bus is still busy the read is skipped and retried next call.
+	HAL_I2C_Master_Receive_IT(&hi2c1, PCT2075_I2C_ADDR, rx_buffer, sizeof(rx_buffer));
+}
+
+int16_t pcb_temperature_driver__get_last_temperature(void) {
+	return last_temperature;
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+	if (hi2c == &hi2c1) {
+		last_temperature = pcb_temperature_decode(rx_buffer);
+	}
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+	if (hi2c == &hi2c1) {
+		last_temperature = ADC_READING_ERROR;
+	}
+}
+
+static int16_t pcb_temperature_decode(uint8_t *buffer) {
+	// 11 bit signed (2s compl.) temperature, 0.125°C per LSB, left aligned in the 16 bit register
+	int16_t temp_register = (int16_t)((buffer[0] << 8) | buffer[1]);
+	return (temp_register >> 5) / 8;
+}
@@ -105,6 +105,14 @@ extern SPI_HandleTypeDef SSD1306_SPI_PORT;
 #define SSD1306_BUFFER_SIZE   SSD1306_WIDTH * SSD1306_HEIGHT / 8
 #endif
 
+// 8 pixel rows per display RAM page
+#define SSD1306_PAGES           (SSD1306_HEIGHT / 8)
+
+// SPI: a DMA flush that takes longer is aborted and its pages are sent again
+#ifndef SSD1306_FLUSH_TIMEOUT_MS
+#define SSD1306_FLUSH_TIMEOUT_MS    50
+#endif
+
 // Enumeration for screen colors
 typedef enum {
     Black = 0x00, // Black color, no pixel
@@ -132,7 +140,12 @@ typedef struct {
 // Procedure definitions
 void ssd1306_Init(void);
 void ssd1306_Fill(SSD1306_COLOR color);
-void ssd1306_UpdateScreen(void);
+void ssd1306_UpdateScreen(void);   // sends only the changed column range of each page, SPI: starts a DMA flush and returns
+#if defined(SSD1306_USE_SPI)
+uint8_t ssd1306_IsFlushBusy(void);  // a DMA flush is running
+#endif
+void ssd1306_MarkDirty(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+uint16_t ssd1306_GetDirtyBytes(void);
 void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color);
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color);
 char ssd1306_WriteString(char* str, FontDef Font, SSD1306_COLOR color);
@@ -143,6 +156,8 @@ void ssd1306_DrawCircle(uint8_t par_x, uint8_t par_y, uint8_t par_r, SSD1306_COL
 void ssd1306_Polyline(const SSD1306_VERTEX *par_vertex, uint16_t par_size, SSD1306_COLOR color);
 void ssd1306_DrawRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color);
 void ssd1306_DrawFilledRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color);
+void ssd1306_DrawHLine(uint8_t x1, uint8_t x2, uint8_t y, SSD1306_COLOR color);
+void ssd1306_DrawVLine(uint8_t x, uint8_t y1, uint8_t y2, SSD1306_COLOR color);
 /**
  * @brief Sets the contrast of the display.
  * @param[in] value contrast to set.
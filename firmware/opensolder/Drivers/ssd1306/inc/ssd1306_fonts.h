@@ -8,7 +8,7 @@
 typedef struct {
 	const uint8_t FontWidth;    /*!< Font width in pixels */
 	uint8_t FontHeight;   /*!< Font height in pixels */
-	const uint16_t *data; /*!< Pointer to data font data array */
+	const uint8_t *data;  /*!< Pointer to the glyphs in display page layout, see ssd1306_font_pages.c */
 } FontDef;
 
 #ifdef SSD1306_INCLUDE_FONT_6x8
@@ -23,4 +23,20 @@ extern FontDef Font_11x18;
 #ifdef SSD1306_INCLUDE_FONT_16x26
 extern FontDef Font_16x26;
 #endif
+
+#ifdef SSD1306_INCLUDE_FONT_ROWS
+// Row format source tables of ssd1306_fonts.c, host tests only
+#ifdef SSD1306_INCLUDE_FONT_6x8
+extern const uint16_t Font6x8[];
+#endif
+#ifdef SSD1306_INCLUDE_FONT_7x10
+extern const uint16_t Font7x10[];
+#endif
+#ifdef SSD1306_INCLUDE_FONT_11x18
+extern const uint16_t Font11x18[];
+#endif
+#ifdef SSD1306_INCLUDE_FONT_16x26
+extern const uint16_t Font16x26[];
+#endif
+#endif
 #endif // __SSD1306_FONTS_H__
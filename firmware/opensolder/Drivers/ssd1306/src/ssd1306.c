@@ -21,6 +21,8 @@ void ssd1306_WriteData(uint8_t* buffer, size_t buff_size) {
 
 #elif defined(SSD1306_USE_SPI)
 
+static void ssd1306_WaitFlush(void);
+
 void ssd1306_Reset(void) {
     // CS = High (not selected)
     HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_SET);
@@ -34,6 +36,7 @@ void ssd1306_Reset(void) {
 
 // Send a byte to the command register
 void ssd1306_WriteCommand(uint8_t byte) {
+    ssd1306_WaitFlush(); // the bus belongs to a running DMA flush
     HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_RESET); // select OLED
     HAL_GPIO_WritePin(SSD1306_DC_Port, SSD1306_DC_Pin, GPIO_PIN_RESET); // command
     HAL_SPI_Transmit(&SSD1306_SPI_PORT, (uint8_t *) &byte, 1, HAL_MAX_DELAY);
@@ -42,6 +45,7 @@ void ssd1306_WriteCommand(uint8_t byte) {
 
 // Send data
 void ssd1306_WriteData(uint8_t* buffer, size_t buff_size) {
+    ssd1306_WaitFlush();
     HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_RESET); // select OLED
     HAL_GPIO_WritePin(SSD1306_DC_Port, SSD1306_DC_Pin, GPIO_PIN_SET); // data
     HAL_SPI_Transmit(&SSD1306_SPI_PORT, buffer, buff_size, HAL_MAX_DELAY);
@@ -56,6 +60,111 @@ void ssd1306_WriteData(uint8_t* buffer, size_t buff_size) {
 // Screenbuffer
 static uint8_t SSD1306_Buffer[SSD1306_BUFFER_SIZE];
 
+// Changed column range of every page since the last ssd1306_UpdateScreen(), clean if start > end
+static uint8_t SSD1306_DirtyStart[SSD1306_PAGES];
+static uint8_t SSD1306_DirtyEnd[SSD1306_PAGES];
+
+static inline void ssd1306_MarkPageDirty(uint8_t page, uint8_t x1, uint8_t x2);
+
+#if defined(SSD1306_USE_SPI)
+
+// Asynchronous flush over SPI TX DMA. ssd1306_UpdateScreen() copies the dirty page ranges into SSD1306_TxBuffer and
+// starts the transfer, the drawing functions keep working on SSD1306_Buffer meanwhile. The transfer is chained in
+// the DMA complete interrupt: command bytes (DC low) and data (DC high) of each dirty page, CS stays low throughout.
+static uint8_t SSD1306_TxBuffer[SSD1306_BUFFER_SIZE];
+static uint8_t SSD1306_TxCommands[SSD1306_PAGES][6];
+static uint8_t SSD1306_TxStart[SSD1306_PAGES];     // staged column range per page, none if start > end
+static uint8_t SSD1306_TxEnd[SSD1306_PAGES];
+static volatile uint8_t SSD1306_FlushPage;         // page being sent
+static volatile uint8_t SSD1306_FlushData;         // 0: command bytes of SSD1306_FlushPage, 1: its data
+static volatile uint8_t SSD1306_FlushBusy = 0;
+static volatile uint8_t SSD1306_FlushFailed = 0;   // set by the SPI error callback
+static uint32_t SSD1306_FlushStartTick;
+
+// Finds the next staged page after page, SSD1306_PAGES if none is left
+static uint8_t ssd1306_NextStagedPage(uint8_t page) {
+    while(page < SSD1306_PAGES && SSD1306_TxStart[page] > SSD1306_TxEnd[page]) {
+        page++;
+    }
+    return page;
+}
+
+// Sends the command bytes of a staged page, or ends the transaction after the last one
+static void ssd1306_FlushPageCommands(uint8_t page) {
+    if(page >= SSD1306_PAGES) {
+        HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_SET); // un-select OLED
+        SSD1306_FlushBusy = 0;
+        return;
+    }
+    SSD1306_FlushPage = page;
+    SSD1306_FlushData = 0;
+    HAL_GPIO_WritePin(SSD1306_DC_Port, SSD1306_DC_Pin, GPIO_PIN_RESET); // command
+    if(HAL_SPI_Transmit_DMA(&SSD1306_SPI_PORT, SSD1306_TxCommands[page], sizeof(SSD1306_TxCommands[page])) != HAL_OK) {
+        SSD1306_FlushFailed = 1;
+    }
+}
+
+// Gives up a flush that failed or timed out. The staged pages are sent again with the next ssd1306_UpdateScreen()
+static void ssd1306_FlushAbort(void) {
+    HAL_SPI_Abort(&SSD1306_SPI_PORT);
+    HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_SET); // un-select OLED
+    for(uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        if(SSD1306_TxStart[page] <= SSD1306_TxEnd[page]) {
+            ssd1306_MarkPageDirty(page, SSD1306_TxStart[page], SSD1306_TxEnd[page]);
+        }
+    }
+    SSD1306_FlushFailed = 0;
+    SSD1306_FlushBusy = 0;
+}
+
+// Returns RESET if no flush is running (any more). A flush that failed or exceeded SSD1306_FLUSH_TIMEOUT_MS is aborted
+static uint8_t ssd1306_FlushPending(void) {
+    if(!SSD1306_FlushBusy) {
+        return RESET;
+    }
+    if(SSD1306_FlushFailed || (HAL_GetTick() - SSD1306_FlushStartTick > SSD1306_FLUSH_TIMEOUT_MS)) {
+        ssd1306_FlushAbort();
+        return RESET;
+    }
+    return SET;
+}
+
+// The blocking transfers wait for a running flush, a stalled SPI is given up after SSD1306_FLUSH_TIMEOUT_MS
+static void ssd1306_WaitFlush(void) {
+    while(ssd1306_FlushPending()) {
+    }
+}
+
+// Chains the flush transfers, called from the SPI TX DMA complete interrupt
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if(hspi != &SSD1306_SPI_PORT || !SSD1306_FlushBusy) {
+        return;
+    }
+    if(SSD1306_FlushData) {
+        ssd1306_FlushPageCommands(ssd1306_NextStagedPage(SSD1306_FlushPage + 1));
+        return;
+    }
+    uint8_t page = SSD1306_FlushPage;
+    SSD1306_FlushData = 1;
+    HAL_GPIO_WritePin(SSD1306_DC_Port, SSD1306_DC_Pin, GPIO_PIN_SET); // data
+    if(HAL_SPI_Transmit_DMA(&SSD1306_SPI_PORT, &SSD1306_TxBuffer[SSD1306_WIDTH*page + SSD1306_TxStart[page]],
+            SSD1306_TxEnd[page] - SSD1306_TxStart[page] + 1) != HAL_OK) {
+        SSD1306_FlushFailed = 1;
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    if(hspi == &SSD1306_SPI_PORT) {
+        SSD1306_FlushFailed = 1;    // aborted from the main loop
+    }
+}
+
+uint8_t ssd1306_IsFlushBusy(void) {
+    return SSD1306_FlushBusy;
+}
+
+#endif
+
 // Screen object
 static SSD1306_t SSD1306;
 
@@ -64,11 +173,49 @@ SSD1306_Error_t ssd1306_FillBuffer(uint8_t* buf, uint32_t len) {
     SSD1306_Error_t ret = SSD1306_ERR;
     if (len <= SSD1306_BUFFER_SIZE) {
         memcpy(SSD1306_Buffer,buf,len);
+        ssd1306_MarkDirty(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1);
         ret = SSD1306_OK;
     }
     return ret;
 }
 
+/* Adds the columns x1..x2 of one page to the area sent by the next ssd1306_UpdateScreen() */
+static inline void ssd1306_MarkPageDirty(uint8_t page, uint8_t x1, uint8_t x2) {
+    if (x1 < SSD1306_DirtyStart[page]) {
+        SSD1306_DirtyStart[page] = x1;
+    }
+    if (x2 > SSD1306_DirtyEnd[page]) {
+        SSD1306_DirtyEnd[page] = x2;
+    }
+}
+
+/* Marks a screen area to be sent by the next ssd1306_UpdateScreen(), e.g. after writing the buffer directly */
+void ssd1306_MarkDirty(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2) {
+    if (x2 >= SSD1306_WIDTH) {
+        x2 = SSD1306_WIDTH - 1;
+    }
+    if (y2 >= SSD1306_HEIGHT) {
+        y2 = SSD1306_HEIGHT - 1;
+    }
+    if (x1 > x2 || y1 > y2) {
+        return;
+    }
+    for (uint8_t page = y1 / 8; page <= y2 / 8; page++) {
+        ssd1306_MarkPageDirty(page, x1, x2);
+    }
+}
+
+/* Number of display data bytes the next ssd1306_UpdateScreen() sends */
+uint16_t ssd1306_GetDirtyBytes(void) {
+    uint16_t bytes = 0;
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        if (SSD1306_DirtyStart[page] <= SSD1306_DirtyEnd[page]) {
+            bytes += SSD1306_DirtyEnd[page] - SSD1306_DirtyStart[page] + 1;
+        }
+    }
+    return bytes;
+}
+
 // Initialize the oled screen
 void ssd1306_Init(void) {
     // Reset OLED
@@ -158,8 +305,9 @@ void ssd1306_Init(void) {
     ssd1306_WriteCommand(0x14); //
     ssd1306_SetDisplayOn(1); //--turn on SSD1306 panel
 
-    // Clear screen
+    // Clear screen, the display RAM content after reset is undefined
     ssd1306_Fill(Black);
+    ssd1306_MarkDirty(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1);
     
     // Flush buffer to screen
     ssd1306_UpdateScreen();
@@ -173,30 +321,89 @@ void ssd1306_Init(void) {
 
 // Fill the whole screen with the given color
 void ssd1306_Fill(SSD1306_COLOR color) {
-    /* Set memory */
-    uint32_t i;
+    /* Set memory, only bytes that change make their page dirty */
+    uint8_t value = (color == Black) ? 0x00 : 0xFF;
+
+    for(uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        uint8_t *row = &SSD1306_Buffer[SSD1306_WIDTH * page];
+        for(uint8_t x = 0; x < SSD1306_WIDTH; x++) {
+            if(row[x] != value) {
+                row[x] = value;
+                ssd1306_MarkPageDirty(page, x, x);
+            }
+        }
+    }
+}
+
+#if defined(SSD1306_USE_SPI)
 
-    for(i = 0; i < sizeof(SSD1306_Buffer); i++) {
-        SSD1306_Buffer[i] = (color == Black) ? 0x00 : 0xFF;
+// Start sending the changed parts of the screenbuffer to the screen, returns without waiting for the transfer.
+// While a flush is running, the changes stay dirty and go out with the next call
+void ssd1306_UpdateScreen(void) {
+    if(ssd1306_FlushPending()) {
+        return;
     }
+
+    // Stage the dirty column range of each page with its address window commands
+    for(uint8_t i = 0; i < SSD1306_PAGES; i++) {
+        uint8_t start = SSD1306_DirtyStart[i];
+        uint8_t end = SSD1306_DirtyEnd[i];
+        SSD1306_TxStart[i] = start;
+        SSD1306_TxEnd[i] = end;
+        if(start > end) {
+            continue;   // page unchanged
+        }
+        memcpy(&SSD1306_TxBuffer[SSD1306_WIDTH*i + start], &SSD1306_Buffer[SSD1306_WIDTH*i + start], end - start + 1);
+        SSD1306_TxCommands[i][0] = 0x21;    // Set the column address window (horizontal addressing mode)
+        SSD1306_TxCommands[i][1] = start;
+        SSD1306_TxCommands[i][2] = end;
+        SSD1306_TxCommands[i][3] = 0x22;    // Set the page address window
+        SSD1306_TxCommands[i][4] = i;
+        SSD1306_TxCommands[i][5] = i;
+        SSD1306_DirtyStart[i] = UINT8_MAX;
+        SSD1306_DirtyEnd[i] = 0;
+    }
+
+    uint8_t page = ssd1306_NextStagedPage(0);
+    if(page >= SSD1306_PAGES) {
+        return;     // nothing changed
+    }
+    SSD1306_FlushBusy = 1;
+    SSD1306_FlushStartTick = HAL_GetTick();
+    HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_RESET); // select OLED for the whole frame
+    ssd1306_FlushPageCommands(page);
 }
 
-// Write the screenbuffer with changed to the screen
+#else
+
+// Write the changed parts of the screenbuffer to the screen
 void ssd1306_UpdateScreen(void) {
-    // Write data to each page of RAM. Number of pages
+    // Write the changed column range of each page of RAM. Number of pages
     // depends on the screen height:
     //
     //  * 32px   ==  4 pages
     //  * 64px   ==  8 pages
     //  * 128px  ==  16 pages
-    for(uint8_t i = 0; i < SSD1306_HEIGHT/8; i++) {
-        ssd1306_WriteCommand(0xB0 + i); // Set the current RAM page address.
-        ssd1306_WriteCommand(0x00);
-        ssd1306_WriteCommand(0x10);
-        ssd1306_WriteData(&SSD1306_Buffer[SSD1306_WIDTH*i],SSD1306_WIDTH);
+    for(uint8_t i = 0; i < SSD1306_PAGES; i++) {
+        uint8_t start = SSD1306_DirtyStart[i];
+        uint8_t end = SSD1306_DirtyEnd[i];
+        if(start > end) {
+            continue;   // page unchanged
+        }
+        ssd1306_WriteCommand(0x21); // Set the column address window (horizontal addressing mode)
+        ssd1306_WriteCommand(start);
+        ssd1306_WriteCommand(end);
+        ssd1306_WriteCommand(0x22); // Set the page address window
+        ssd1306_WriteCommand(i);
+        ssd1306_WriteCommand(i);
+        ssd1306_WriteData(&SSD1306_Buffer[SSD1306_WIDTH*i + start], end - start + 1);
+        SSD1306_DirtyStart[i] = UINT8_MAX;
+        SSD1306_DirtyEnd[i] = 0;
     }
 }
 
+#endif
+
 //    Draw one pixel in the screenbuffer
 //    X => X Coordinate
 //    Y => Y Coordinate
@@ -212,11 +419,27 @@ void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color) {
         color = (SSD1306_COLOR)!color;
     }
     
-    // Draw in the right color
+    // Draw in the right color, only a changed byte makes the page dirty
+    uint8_t *byte = &SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH];
+    uint8_t value;
     if(color == White) {
-        SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] |= 1 << (y % 8);
+        value = *byte | (1 << (y % 8));
     } else { 
-        SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] &= ~(1 << (y % 8));
+        value = *byte & ~(1 << (y % 8));
+    }
+    if(value != *byte) {
+        *byte = value;
+        ssd1306_MarkPageDirty(y / 8, x, x);
+    }
+}
+
+// Write the masked bits of one screenbuffer byte, only a changed byte makes the page dirty
+static inline void ssd1306_WriteBits(uint8_t page, uint8_t x, uint8_t value, uint8_t mask) {
+    uint8_t *byte = &SSD1306_Buffer[x + page * SSD1306_WIDTH];
+    uint8_t result = (*byte & ~mask) | (value & mask);
+    if(result != *byte) {
+        *byte = result;
+        ssd1306_MarkPageDirty(page, x, x);
     }
 }
 
@@ -225,7 +448,7 @@ void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color) {
 // Font     => Font waarmee we gaan schrijven
 // color    => Black or White
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color) {
-    uint32_t i, b, j;
+    uint32_t i, j;
     
     // Check if character is valid
     if (ch < 32 || ch > 126)
@@ -239,14 +462,23 @@ char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color) {
         return 0;
     }
     
-    // Use the font to write
-    for(i = 0; i < Font.FontHeight; i++) {
-        b = Font.data[(ch - 32) * Font.FontHeight + i];
+    // The glyph is stored in page layout (ssd1306_font_pages.c): one byte per column and 8 rows,
+    // it is shifted to the cursor row and written with a mask, glyph and background at once
+    uint8_t glyph_pages = (Font.FontHeight + 7) / 8;
+    const uint8_t *glyph = &Font.data[(ch - 32) * Font.FontWidth * glyph_pages];
+    uint8_t page = SSD1306.CurrentY / 8;
+    uint8_t shift = SSD1306.CurrentY % 8;
+    uint8_t invert = ((color == White) == SSD1306.Inverted) ? 0xFF : 0x00;   // glyph drawn black
+    
+    for(i = 0; i < glyph_pages; i++) {
+        uint8_t rows = Font.FontHeight - i * 8;
+        uint16_t mask = (0xFF >> (8 - (rows < 8 ? rows : 8))) << shift;
         for(j = 0; j < Font.FontWidth; j++) {
-            if((b << j) & 0x8000)  {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR) color);
-            } else {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)!color);
+            uint16_t value = (uint8_t)(*glyph++ ^ invert) << shift;
+            ssd1306_WriteBits(page + i, SSD1306.CurrentX + j, value, mask);
+            if(mask >> 8) {
+                // Rows shifted into the next page, the space check keeps them on the screen
+                ssd1306_WriteBits(page + i + 1, SSD1306.CurrentX + j, value >> 8, mask >> 8);
             }
         }
     }
@@ -436,18 +668,62 @@ void ssd1306_DrawCircle(uint8_t par_x,uint8_t par_y,uint8_t par_r,SSD1306_COLOR
 
 //Draw rectangle
 void ssd1306_DrawRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color) {
-  ssd1306_Line(x1,y1,x2,y1,color);
-  ssd1306_Line(x2,y1,x2,y2,color);
-  ssd1306_Line(x2,y2,x1,y2,color);
-  ssd1306_Line(x1,y2,x1,y1,color);
+  ssd1306_DrawHLine(x1,x2,y1,color);
+  ssd1306_DrawVLine(x2,y1,y2,color);
+  ssd1306_DrawHLine(x1,x2,y2,color);
+  ssd1306_DrawVLine(x1,y1,y2,color);
 
   return;
 }
 
+// Draw a filled rectangle, whole page bytes with masks for the rows at the top and bottom edge.
+// Corners in any order, the part outside the screen is clipped
 void ssd1306_DrawFilledRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color){
-	for (uint8_t y = y1; y <= y2; y++){
-		ssd1306_Line(x1,y,x2,y,color);
+	uint8_t swap;
+	if (x1 > x2) {
+		swap = x1; x1 = x2; x2 = swap;
+	}
+	if (y1 > y2) {
+		swap = y1; y1 = y2; y2 = swap;
 	}
+	if (x1 >= SSD1306_WIDTH || y1 >= SSD1306_HEIGHT) {
+		return;
+	}
+	if (x2 >= SSD1306_WIDTH) {
+		x2 = SSD1306_WIDTH - 1;
+	}
+	if (y2 >= SSD1306_HEIGHT) {
+		y2 = SSD1306_HEIGHT - 1;
+	}
+
+	// Check if the rectangle should be inverted
+	if (SSD1306.Inverted) {
+		color = (SSD1306_COLOR)!color;
+	}
+	uint8_t value = (color == White) ? 0xFF : 0x00;
+
+	for (uint8_t page = y1 / 8; page <= y2 / 8; page++) {
+		uint8_t mask = 0xFF;
+		if (page == y1 / 8) {
+			mask &= 0xFF << (y1 % 8);
+		}
+		if (page == y2 / 8) {
+			mask &= 0xFF >> (7 - y2 % 8);
+		}
+		for (uint8_t x = x1; x <= x2; x++) {
+			ssd1306_WriteBits(page, x, value, mask);
+		}
+	}
+}
+
+// Draw a horizontal span from x1 to x2 in row y
+void ssd1306_DrawHLine(uint8_t x1, uint8_t x2, uint8_t y, SSD1306_COLOR color) {
+	ssd1306_DrawFilledRectangle(x1, y, x2, y, color);
+}
+
+// Draw a vertical span from y1 to y2 in column x, one masked byte per page
+void ssd1306_DrawVLine(uint8_t x, uint8_t y1, uint8_t y2, SSD1306_COLOR color) {
+	ssd1306_DrawFilledRectangle(x, y1, x, y2, color);
 }
 
 void ssd1306_SetContrast(const uint8_t value) {
@@ -1,8 +1,13 @@
 
 #include "../inc/ssd1306_fonts.h"
 
+// Source of the glyphs, one uint16_t per row with the leftmost pixel in bit 15. The firmware uses the page
+// layout in ssd1306_font_pages.c, generated from this file by tools/ssd1306_font_pages.py. The row tables are
+// only compiled with SSD1306_INCLUDE_FONT_ROWS (host tests)
+#ifdef SSD1306_INCLUDE_FONT_ROWS
+
 #ifdef SSD1306_INCLUDE_FONT_7x10
-static const uint16_t Font7x10 [] = {
+const uint16_t Font7x10 [] = {
 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // sp
 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x0000, 0x1000, 0x0000, 0x0000,  // !
 0x2800, 0x2800, 0x2800, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // "
@@ -103,7 +108,7 @@ static const uint16_t Font7x10 [] = {
 #endif
 
 #ifdef SSD1306_INCLUDE_FONT_11x18
-static const uint16_t Font11x18 [] = {
+const uint16_t Font11x18 [] = {
 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,   // sp
 0x0000, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0C00, 0x0000, 0x0C00, 0x0C00, 0x0000, 0x0000, 0x0000,   // !
 0x0000, 0x1B00, 0x1B00, 0x1B00, 0x1B00, 0x1B00, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,   // "
@@ -203,7 +208,7 @@ static const uint16_t Font11x18 [] = {
 };
 #endif
 #ifdef SSD1306_INCLUDE_FONT_16x26
-static const uint16_t Font16x26 [] = {
+const uint16_t Font16x26 [] = {
 0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000, // Ascii = [ ]
 0x03E0,0x03E0,0x03E0,0x03E0,0x03E0,0x03E0,0x03E0,0x03E0,0x03C0,0x03C0,0x01C0,0x01C0,0x01C0,0x01C0,0x01C0,0x0000,0x0000,0x0000,0x03E0,0x03E0,0x03E0,0x0000,0x0000,0x0000,0x0000,0x0000, // Ascii = [!]
 0x1E3C,0x1E3C,0x1E3C,0x1E3C,0x1E3C,0x1E3C,0x1E3C,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000, // Ascii = ["]
@@ -302,7 +307,7 @@ static const uint16_t Font16x26 [] = {
 };
 #endif
 #ifdef SSD1306_INCLUDE_FONT_6x8
-static const uint16_t Font6x8 [] = {
+const uint16_t Font6x8 [] = {
 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // sp
 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x2000, 0x0000,  // !
 0x5000, 0x5000, 0x5000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // "
@@ -402,15 +407,4 @@ static const uint16_t Font6x8 [] = {
 };
 #endif
 
-#ifdef SSD1306_INCLUDE_FONT_6x8
-FontDef Font_6x8 = {6,8,Font6x8};
-#endif
-#ifdef SSD1306_INCLUDE_FONT_7x10
-FontDef Font_7x10 = {7,10,Font7x10};
-#endif
-#ifdef SSD1306_INCLUDE_FONT_11x18
-FontDef Font_11x18 = {11,18,Font11x18};
-#endif
-#ifdef SSD1306_INCLUDE_FONT_16x26
-FontDef Font_16x26 = {16,26,Font16x26};
-#endif
+#endif // SSD1306_INCLUDE_FONT_ROWS
@@ -0,0 +1,109 @@
+/*
+ * autotune_test.c
+ *
+ * Runs the relay auto-tuner on a simulated first order plus dead time plant (tip temperature)
+ * and checks Ku, Tu and the Pessen gains against the analytic limit cycle of the relay.
+ *
+ * Plant: tau * dy/dt = K * u(t - L) - y, y is the temperature above ambient, u the Q15 output.
+ * The ambient is chosen so that the relay output swings +/-d around the power that holds the
+ * setpoint, the limit cycle is then symmetric. The relay switches at +/-e around the setpoint and
+ * the temperature keeps moving towards the other side for the dead time L:
+ *   peak       a  = K * d - (K * d - e) * exp(-L / tau)		(from the setpoint)
+ *   half cycle Tu / 2 = L + tau * ln((K * d + a) / (K * d - e))
+ *   Ku = 4 * d / (pi * a)
+ *   Pessen: kp = 0.33 * Ku, ki = kp / (Tu / 2), kd = kp * Tu / 3
+ *
+ * NOTES:
+ * - The measurement is rounded to whole °C like the firmware reading. The relay compares whole degrees
+ *   (measurement > setpoint + hysteresis), it switches at +/-(hysteresis + 0.5)°C of the true temperature
+ * - The sampling and the rounding of the peaks limit the tolerance, the integer gains are truncated
+ *   by up to one unit on top
+ */
+
+#include <math.h>
+#include "autotune.h"
+#include "pid.h"
+#include "tip_plant.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+#define SETPOINT			300		// °C
+#define HYSTERESIS			3		// °C, AUTOTUNE_HYSTERESIS
+#define CYCLES				4		// AUTOTUNE_CYCLES
+#define TIMEOUT_MS			120000	// AUTOTUNE_TIMEOUT_MS
+#define TOLERANCE			0.03	// relative
+
+typedef struct {
+	double gain;			// K, °C per Q15 output
+	double tau_ms;			// time constant
+	uint16_t dead_time_ms;	// L, multiple of TIP_PLANT_STEP_MS
+} plant;
+
+static const plant plants[] = {
+	{0.0168, 8000, 1000},	// heavy tip: 575°C at full power, slow
+	{0.0168, 3000, 500},
+	{0.0250, 5000, 1500},	// dead time dominated, stronger heater
+};
+
+/******    Local Function Declarations    ******/
+static void test_plant(const plant *p);
+static uint8_t within(double value, double expected);
+
+/******    functions    ******/
+int main(void) {
+	for (uint8_t i = 0; i < sizeof(plants) / sizeof(plants[0]); i++) {
+		test_plant(&plants[i]);
+	}
+	return test_result("autotune_test");
+}
+
+static void test_plant(const plant *p) {
+	const int32_t output_high = PID_OUTPUT_MAX;
+	const double d = (output_high - 0) / 2.0;
+	const double ambient = SETPOINT - p->gain * d;
+
+	// Analytic relay limit cycle
+	const double e = HYSTERESIS + 0.5;
+	const double kd_swing = p->gain * d;
+	const double a = kd_swing - (kd_swing - e) * exp(-p->dead_time_ms / p->tau_ms);
+	const double tu_ms = 2 * (p->dead_time_ms + p->tau_ms * log((kd_swing + a) / (kd_swing - e)));
+	const double ku = 4 * d / (M_PI * a);
+	const double kp = 0.33 * ku;
+	const double ki = kp * 2 * PID_TIME_BASE_MS / tu_ms;
+	const double kd = kp * tu_ms / (3 * PID_TIME_BASE_MS);
+
+	autotune tuner;
+	autotune_start(&tuner, SETPOINT, HYSTERESIS, 0, output_high, CYCLES, TIMEOUT_MS);
+
+	// Cold tip, the measurement is read every plant step
+	tip_plant tip;
+	tip_plant_init(&tip, p->gain, p->tau_ms, p->dead_time_ms, ambient);
+	uint32_t time_ms = 0;
+	while ((autotune_get_state(&tuner) == AUTOTUNE_RUNNING) && (time_ms <= 2 * TIMEOUT_MS)) {
+		tip_plant_step(&tip, autotune_update(&tuner, tip_plant_read(&tip), TIP_PLANT_STEP_MS));
+		time_ms += TIP_PLANT_STEP_MS;
+	}
+
+	int32_t tuned_kp, tuned_ki, tuned_kd;
+	autotune_get_gains(&tuner, &tuned_kp, &tuned_ki, &tuned_kd);
+	double tuned_tu_ms = tuner.period_sum_ms / (double)tuner.cycles;
+	double tuned_ku = 8.0 * (d * tuner.cycles) / (M_PI * tuner.amplitude_sum);
+
+	unsigned failures = test_failures;
+	CHECK(autotune_get_state(&tuner) == AUTOTUNE_DONE);
+	CHECK(tuner.cycles == CYCLES);
+	CHECK(within(tuned_tu_ms, tu_ms));
+	CHECK(within(tuned_ku, ku));
+	CHECK(within(tuned_kp, kp) || within(tuned_kp + 1, kp));
+	CHECK(within(tuned_ki, ki) || within(tuned_ki + 1, ki));
+	CHECK(within(tuned_kd, kd) || within(tuned_kd + 1, kd));
+	if (test_failures != failures) {
+		printf("plant K %.4f tau %.0fms L %ums: Tu %.0f/%.0fms Ku %.1f/%.1f kp %ld/%.1f ki %ld/%.1f kd %ld/%.1f\n",
+				p->gain, p->tau_ms, p->dead_time_ms, tuned_tu_ms, tu_ms, tuned_ku, ku,
+				(long)tuned_kp, kp, (long)tuned_ki, ki, (long)tuned_kd, kd);
+	}
+}
+
+static uint8_t within(double value, double expected) {
+	return fabs(value - expected) <= TOLERANCE * fabs(expected);
+}
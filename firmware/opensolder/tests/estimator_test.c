@@ -0,0 +1,158 @@
+/*
+ * estimator_test.c
+ *
+ * Checks the tip temperature Kalman filter of estimator.c
+ * - predict and update converge on a simulated tip whose heater is 10% stronger than the model
+ * - an estimate that is off (within the gate) converges to the readings
+ * - a reading beyond ESTIMATOR_GATE_TEMP re-initializes the filter to the reading
+ * - the Q8 heater energy of a partial half cycle heats by its share
+ * - no prediction before the first reading
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "estimator.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+#define HEAT_RATE			9175	// C245 model of opensolder.h, Q16 °C per ms of heater on time
+#define COOLING_TIME_MS		30000
+#define PROCESS_NOISE		5		// Q10 °C² per ms
+#define MEASUREMENT_NOISE	1024	// Q10 °C²
+#define AMBIENT				25		// °C
+
+#define HALF_CYCLE_MS		10		// 50Hz
+#define READING_INTERVAL	4		// half cycles per reading
+#define TRUE_HEAT_RATE		(HEAT_RATE * 1.1)
+
+/******    Variables    ******/
+static estimator filter;
+static double true_temperature;
+
+/******    Local Function Declarations    ******/
+static void test_tracking(void);
+static void test_convergence(void);
+static void test_gate(void);
+static void test_partial_energy(void);
+static void half_cycle(uint16_t heater_energy);
+static int16_t noisy_reading(uint32_t index);
+
+/******    functions    ******/
+int main(void) {
+	test_tracking();
+	test_convergence();
+	test_gate();
+	test_partial_energy();
+	return test_result("estimator_test");
+}
+
+// Heat up with half the half cycles on, then hold with a quarter: the estimate follows the true temperature
+static void test_tracking(void) {
+	estimator_init(&filter, HEAT_RATE, COOLING_TIME_MS, PROCESS_NOISE, MEASUREMENT_NOISE, AMBIENT);
+	true_temperature = AMBIENT;
+
+	double max_error = 0;
+	for (uint32_t i = 0; i < 3000; i++) {
+		if ((i % READING_INTERVAL) == 0) {
+			estimator_update(&filter, noisy_reading(i));
+		}
+		uint16_t energy = (i < 1500) ? ((i % 2) ? ESTIMATOR_HEATER_ON : 0) : ((i % 4) ? 0 : ESTIMATOR_HEATER_ON);
+		half_cycle(energy);
+		if ((i > 100) && (fabs(estimator_get_temperature(&filter) - true_temperature) > max_error)) {
+			max_error = fabs(estimator_get_temperature(&filter) - true_temperature);
+		}
+	}
+	CHECK(true_temperature > 200);	// the heat up happened
+	CHECK(max_error <= 3);
+	CHECK(filter.variance < MEASUREMENT_NOISE);	// the filter trusts the model between readings
+}
+
+// The first reading initializes, an estimate 40°C off (within the gate) converges to the readings
+static void test_convergence(void) {
+	estimator_init(&filter, HEAT_RATE, COOLING_TIME_MS, PROCESS_NOISE, MEASUREMENT_NOISE, AMBIENT);
+	CHECK(!estimator_is_initialized(&filter));
+	estimator_update(&filter, 200);
+	CHECK(estimator_is_initialized(&filter));
+	CHECK(estimator_get_temperature(&filter) == 200);
+
+	for (uint32_t i = 0; i < 400; i++) {	// settle the variance
+		if ((i % READING_INTERVAL) == 0) {
+			estimator_update(&filter, (int16_t)lround(200 * exp(-(double)i * HALF_CYCLE_MS / COOLING_TIME_MS)
+					+ AMBIENT * (1 - exp(-(double)i * HALF_CYCLE_MS / COOLING_TIME_MS))));
+		}
+		estimator_predict(&filter, 0, HALF_CYCLE_MS);
+	}
+	true_temperature = estimator_get_temperature(&filter) + 40;
+
+	int16_t error = abs(estimator_get_temperature(&filter) - (int16_t)lround(true_temperature));
+	uint8_t decreasing = 1;
+	for (uint32_t i = 0; i < 2000; i++) {
+		if ((i % READING_INTERVAL) == 0) {
+			estimator_update(&filter, (int16_t)lround(true_temperature));
+			int16_t new_error = abs(estimator_get_temperature(&filter) - (int16_t)lround(true_temperature));
+			if (new_error > error) {
+				decreasing = 0;
+			}
+			error = new_error;
+		}
+		half_cycle(0);
+	}
+	CHECK(decreasing);
+	CHECK(error <= 1);
+}
+
+// A reading beyond the gate (tip change, error recovery) restarts the filter from it, one within is weighed
+static void test_gate(void) {
+	estimator_init(&filter, HEAT_RATE, COOLING_TIME_MS, PROCESS_NOISE, MEASUREMENT_NOISE, AMBIENT);
+	for (uint8_t i = 0; i < 50; i++) {
+		estimator_update(&filter, 300);
+		estimator_predict(&filter, 0, HALF_CYCLE_MS);
+	}
+	estimator_update(&filter, 300);
+	CHECK(estimator_get_temperature(&filter) == 300);
+
+	estimator_update(&filter, 300 + ESTIMATOR_GATE_TEMP - 4);
+	int16_t weighed = estimator_get_temperature(&filter);
+	CHECK((weighed > 300) && (weighed < 300 + ESTIMATOR_GATE_TEMP - 4));
+
+	estimator_update(&filter, weighed + ESTIMATOR_GATE_TEMP + 1);
+	CHECK(estimator_get_temperature(&filter) == weighed + ESTIMATOR_GATE_TEMP + 1);
+	CHECK(filter.variance == MEASUREMENT_NOISE);
+
+	estimator_update(&filter, weighed - 1);		// gate below the estimate
+	CHECK(estimator_get_temperature(&filter) == weighed - 1);
+	CHECK(filter.variance == MEASUREMENT_NOISE);
+}
+
+// At ambient there is no cooling, a Q8 share of the half cycle heats by the same share
+static void test_partial_energy(void) {
+	estimator_init(&filter, HEAT_RATE, COOLING_TIME_MS, PROCESS_NOISE, MEASUREMENT_NOISE, AMBIENT);
+	estimator_predict(&filter, ESTIMATOR_HEATER_ON, HALF_CYCLE_MS);
+	CHECK(filter.temperature == 0);		// no reading yet, nothing to predict from
+
+	int32_t full_step = (HEAT_RATE * HALF_CYCLE_MS * ESTIMATOR_HEATER_ON) >> ESTIMATOR_HEATER_SHIFT;
+	const uint16_t energies[] = {0, 1, 64, 128, 200, ESTIMATOR_HEATER_ON};
+	for (uint8_t i = 0; i < sizeof(energies) / sizeof(energies[0]); i++) {
+		estimator_reset(&filter);
+		estimator_update(&filter, AMBIENT);
+		int32_t before = filter.temperature;
+		estimator_predict(&filter, energies[i], HALF_CYCLE_MS);
+		int32_t step = filter.temperature - before;
+		CHECK(step == ((HEAT_RATE * HALF_CYCLE_MS * energies[i]) >> ESTIMATOR_HEATER_SHIFT));
+		CHECK(abs(step * ESTIMATOR_HEATER_ON - full_step * energies[i]) < ESTIMATOR_HEATER_ON);
+	}
+}
+
+// One half cycle of the true tip (exact first order step, stronger heater) and of the filter
+static void half_cycle(uint16_t heater_energy) {
+	double heating = TRUE_HEAT_RATE / 65536.0 * heater_energy / ESTIMATOR_HEATER_ON;	// °C per ms
+	double steady_state = AMBIENT + heating * COOLING_TIME_MS;
+	true_temperature = steady_state + (true_temperature - steady_state) * exp(-(double)HALF_CYCLE_MS / COOLING_TIME_MS);
+	estimator_predict(&filter, heater_energy, HALF_CYCLE_MS);
+}
+
+// Rounded true temperature with a repeatable +/-1°C noise
+static int16_t noisy_reading(uint32_t index) {
+	static const int8_t noise[] = {0, 1, -1, 1, 0, -1, -1, 1, 0};
+	return (int16_t)lround(true_temperature) + noise[index % sizeof(noise)];
+}
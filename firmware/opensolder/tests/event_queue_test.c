@@ -0,0 +1,107 @@
+/*
+ * event_queue_test.c
+ *
+ * Checks the ring buffer of event_queue.c
+ * - an empty queue pops nothing, a full queue holds EVENT_QUEUE_LENGTH - 1 events
+ * - pushes to a full queue are dropped and counted, the queued events stay intact
+ * - FIFO order with type and value, also while head and tail wrap many times
+ */
+
+#include "event_queue.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+#define CAPACITY	(EVENT_QUEUE_LENGTH - 1)
+
+/******    Variables    ******/
+static event_queue queue;
+
+/******    Local Function Declarations    ******/
+static void test_empty(void);
+static void test_full(void);
+static void test_wrap(void);
+static uint8_t pop_expected(int16_t value);
+
+/******    functions    ******/
+int main(void) {
+	test_empty();
+	test_full();
+	test_wrap();
+	return test_result("event_queue_test");
+}
+
+static void test_empty(void) {
+	event_queue_init(&queue);
+	event result = {.type = 7, .value = 1234};
+	CHECK(!event_queue_pop(&queue, &result));
+	CHECK((result.type == 7) && (result.value == 1234));	// untouched
+	CHECK(event_queue_get_dropped(&queue) == 0);
+
+	CHECK(event_queue_push(&queue, 3, -5));
+	CHECK(event_queue_pop(&queue, &result));
+	CHECK((result.type == 3) && (result.value == -5));
+	CHECK(!event_queue_pop(&queue, &result));
+}
+
+// The producer keeps running while the consumer does not: every push beyond the capacity is counted
+static void test_full(void) {
+	event_queue_init(&queue);
+	for (int16_t i = 0; i < CAPACITY; i++) {
+		CHECK(event_queue_push(&queue, (uint8_t)i, i));
+	}
+	for (uint8_t i = 1; i <= 10; i++) {
+		CHECK(!event_queue_push(&queue, 0xff, -1));
+		CHECK(event_queue_get_dropped(&queue) == i);
+	}
+
+	// One pop frees one slot
+	CHECK(pop_expected(0));
+	CHECK(event_queue_push(&queue, CAPACITY, CAPACITY));
+	CHECK(!event_queue_push(&queue, 0xff, -1));
+	CHECK(event_queue_get_dropped(&queue) == 11);
+
+	for (int16_t i = 1; i <= CAPACITY; i++) {
+		CHECK(pop_expected(i));
+	}
+	event result;
+	CHECK(!event_queue_pop(&queue, &result));
+	CHECK(event_queue_get_dropped(&queue) == 11);		// kept until init
+
+	event_queue_init(&queue);
+	CHECK(event_queue_get_dropped(&queue) == 0);
+}
+
+// Bursts of 1 to the capacity less the 2 events left queued, head and tail start at every slot
+static void test_wrap(void) {
+	event_queue_init(&queue);
+	int16_t pushed = 0;
+	int16_t popped = 0;
+	for (uint16_t round = 0; round < 10 * EVENT_QUEUE_LENGTH; round++) {
+		uint8_t burst = 1 + round % (CAPACITY - 2);
+		for (uint8_t i = 0; i < burst; i++) {
+			CHECK(event_queue_push(&queue, (uint8_t)pushed, pushed));
+			pushed++;
+		}
+		// Leave a few queued, so the tail trails the head across the wrap
+		while (popped < pushed - round % 3) {
+			CHECK(pop_expected(popped));
+			popped++;
+		}
+	}
+	while (popped < pushed) {
+		CHECK(pop_expected(popped));
+		popped++;
+	}
+	event result;
+	CHECK(!event_queue_pop(&queue, &result));
+	CHECK(event_queue_get_dropped(&queue) == 0);
+}
+
+// The next event carries the type and value pushed as number value
+static uint8_t pop_expected(int16_t value) {
+	event result;
+	if (!event_queue_pop(&queue, &result)) {
+		return 0;
+	}
+	return (result.type == (uint8_t)value) && (result.value == value);
+}
@@ -0,0 +1,146 @@
+/*
+ * isr_stats_test.c
+ *
+ * Checks the interrupt statistics of isr_stats.c
+ * - the log2 histogram buckets at both boundaries of every bucket, 0µs and everything from 1024µs up
+ * - count, min and max, the saturation of the histogram counters
+ * - consistent copies and the reset
+ * - the formatted line and its truncation to short buffers
+ */
+
+#include <string.h>
+#include "isr_stats.h"
+#include "test.h"
+
+/******    Variables    ******/
+static isr_stats stats;
+
+/******    Local Function Declarations    ******/
+static void test_buckets(void);
+static void test_saturation(void);
+static void test_copy_and_reset(void);
+static void test_format(void);
+static void test_format_truncation(void);
+static int8_t single_bucket(void);
+
+/******    functions    ******/
+int main(void) {
+	test_buckets();
+	test_saturation();
+	test_copy_and_reset();
+	test_format();
+	test_format_truncation();
+	return test_result("isr_stats_test");
+}
+
+// Bucket n counts 2^(n-1) to 2^n - 1 µs, bucket 0 counts 0µs, the last one 1024µs and above
+static void test_buckets(void) {
+	isr_stats_reset(&stats);
+	isr_stats_record(&stats, 0);
+	CHECK(single_bucket() == 0);
+
+	for (uint8_t bucket = 1; bucket < ISR_STATS_BUCKETS - 1; bucket++) {
+		isr_stats_reset(&stats);
+		isr_stats_record(&stats, 1 << (bucket - 1));
+		CHECK(single_bucket() == bucket);
+		isr_stats_reset(&stats);
+		isr_stats_record(&stats, (1 << bucket) - 1);
+		CHECK(single_bucket() == bucket);
+	}
+
+	const uint16_t overflow[] = {1024, 1025, 2047, 4096, UINT16_MAX};
+	for (uint8_t i = 0; i < sizeof(overflow) / sizeof(overflow[0]); i++) {
+		isr_stats_reset(&stats);
+		isr_stats_record(&stats, overflow[i]);
+		CHECK(single_bucket() == ISR_STATS_BUCKETS - 1);
+		CHECK((stats.min == overflow[i]) && (stats.max == overflow[i]));
+	}
+}
+
+// The histogram counters stop at UINT16_MAX, the count keeps going
+static void test_saturation(void) {
+	isr_stats_reset(&stats);
+	for (uint32_t i = 0; i < 70000; i++) {
+		isr_stats_record(&stats, 3);
+	}
+	isr_stats_record(&stats, 1);
+	isr_stats_record(&stats, 900);
+	CHECK(stats.count == 70002);
+	CHECK(stats.histogram[2] == UINT16_MAX);
+	CHECK(stats.histogram[1] == 1);
+	CHECK(stats.histogram[10] == 1);
+	CHECK((stats.min == 1) && (stats.max == 900));
+}
+
+static void test_copy_and_reset(void) {
+	isr_stats_reset(&stats);
+	for (uint16_t value = 0; value < 2000; value += 7) {
+		isr_stats_record(&stats, value);
+	}
+	isr_stats copy;
+	isr_stats_copy(&stats, &copy);
+	CHECK(memcmp(&copy, &stats, sizeof(stats)) == 0);
+
+	isr_stats_reset(&stats);
+	CHECK((stats.count == 0) && (stats.min == UINT16_MAX) && (stats.max == 0));
+	CHECK(single_bucket() == -1);
+}
+
+// "name n=123 min=4 max=17 | 0 0 12 111 0 ...", min is 0 without records
+static void test_format(void) {
+	char line[128];
+	isr_stats_reset(&stats);
+	int length = isr_stats_format(&stats, "empty", line, sizeof(line));
+	CHECK(strcmp(line, "empty n=0 min=0 max=0 | 0 0 0 0 0 0 0 0 0 0 0 0\r\n") == 0);
+	CHECK(length == (int)strlen(line));
+
+	isr_stats_record(&stats, 5);
+	isr_stats_record(&stats, 17);
+	isr_stats_record(&stats, 2000);
+	length = isr_stats_format(&stats, "edge", line, sizeof(line));
+	CHECK(strcmp(line, "edge n=3 min=5 max=2000 | 0 0 0 1 0 1 0 0 0 0 0 1\r\n") == 0);
+	CHECK(length == (int)strlen(line));
+}
+
+// A short buffer holds a terminated prefix of the line, the return value tells the line did not fit
+static void test_format_truncation(void) {
+	char full[128];
+	isr_stats_reset(&stats);
+	for (uint32_t i = 0; i < 70000; i++) {
+		isr_stats_record(&stats, i & 0x7ff);	// every bucket saturated, the longest line
+	}
+	int full_length = isr_stats_format(&stats, "heater_switch_latency", full, sizeof(full));
+	CHECK(full_length == (int)strlen(full));
+
+	for (uint16_t length = 1; length <= full_length + 1; length++) {
+		char line[128];
+		memset(line, 'x', sizeof(line));
+		int written = isr_stats_format(&stats, "heater_switch_latency", line, length);
+		CHECK(memchr(line, '\0', length) != NULL);
+		CHECK(strncmp(line, full, strlen(line)) == 0);
+		uint8_t untouched = 1;
+		for (uint16_t i = length; i < sizeof(line); i++) {
+			untouched &= (line[i] == 'x');		// nothing written beyond the buffer
+		}
+		CHECK(untouched);
+		if (length <= full_length) {
+			CHECK(written >= length);
+		} else {
+			CHECK((written == full_length) && (strcmp(line, full) == 0));
+		}
+	}
+}
+
+// Index of the only bucket with a count, -1 if all are empty, -2 if several are
+static int8_t single_bucket(void) {
+	int8_t bucket = -1;
+	for (uint8_t i = 0; i < ISR_STATS_BUCKETS; i++) {
+		if (stats.histogram[i]) {
+			if (bucket >= 0) {
+				return -2;
+			}
+			bucket = i;
+		}
+	}
+	return bucket;
+}
@@ -0,0 +1,134 @@
+/*
+ * pid_test.c
+ *
+ * Runs pid.c in closed loop on the simulated tip of tip_plant.c and checks
+ * - the output never leaves out_min..out_max
+ * - the integrator does not grow while the output is saturated (heat up from ambient)
+ * - a setpoint step does not kick the output through the derivative
+ * - the loop settles without steady state error, also after a load step (heat drawn by the workpiece)
+ *
+ * NOTES:
+ * - The gains are the Pessen gains of the plant (see autotune_test.c), the regulator runs every
+ *   PID_INTERVAL_MS like the firmware after a few heating half cycles
+ */
+
+#include <stdlib.h>
+#include "pid.h"
+#include "tip_plant.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+#define PLANT_GAIN			0.0168	// °C per Q15 output, 575°C above ambient at full power
+#define PLANT_TAU_MS		3000
+#define PLANT_DEAD_TIME_MS	500
+#define AMBIENT				25		// °C
+
+#define KP					152
+#define KI					156
+#define KD					98
+
+#define PID_INTERVAL_MS		100
+#define SETPOINT			300		// °C
+#define SETPOINT_STEP		20		// °C
+#define LOAD_STEP			40		// °C, ambient drop equivalent to the heat drawn by the workpiece
+#define SETTLE_MS			30000	// allowed settling time after every change
+#define HOLD_MS				10000	// the error has to stay within SETTLED_ERROR this long
+#define SETTLED_ERROR		0		// °C, whole degrees like the reading
+
+/******    Variables    ******/
+static pid_controller pid;
+static tip_plant tip;
+static int32_t out_min;
+static int32_t out_max;
+static uint8_t output_in_limits;
+
+/******    Local Function Declarations    ******/
+static int32_t run_pid(int16_t setpoint);
+static int16_t run(int16_t setpoint, uint32_t duration_ms);
+static void test_closed_loop(int32_t min, int32_t max);
+static void test_no_derivative_kick(void);
+
+/******    functions    ******/
+int main(void) {
+	test_closed_loop(0, PID_OUTPUT_MAX);
+	test_closed_loop(0, PID_OUTPUT_MAX * 3 / 4);	// the limit is below full power
+	test_no_derivative_kick();
+	return test_result("pid_test");
+}
+
+static void test_closed_loop(int32_t min, int32_t max) {
+	out_min = min;
+	out_max = max;
+	output_in_limits = 1;
+	pid_init(&pid, KP, KI, KD, out_min, out_max);
+	tip_plant_init(&tip, PLANT_GAIN, PLANT_TAU_MS, PLANT_DEAD_TIME_MS, AMBIENT);
+
+	// Heat up: the output saturates, the integrator must not grow while it is
+	uint8_t windup = 0;
+	uint8_t saturated = 0;
+	for (uint32_t time_ms = 0; time_ms < SETTLE_MS; time_ms += PID_INTERVAL_MS) {
+		int32_t integrator = pid.integrator;
+		int16_t measurement = tip_plant_read(&tip);
+		int32_t output = run_pid(SETPOINT);
+		if (output == out_max) {
+			saturated = 1;
+			if ((measurement < SETPOINT) && (pid.integrator > integrator) && (time_ms > 0)) {
+				windup = 1;
+			}
+		}
+	}
+	CHECK(saturated);
+	CHECK(!windup);
+	CHECK(pid.integrator <= (out_max << PID_TIME_BASE_SHIFT));
+
+	// Settled at the setpoint, after a setpoint step and after a load step
+	CHECK(run(SETPOINT, HOLD_MS) <= SETTLED_ERROR);
+	CHECK(run(SETPOINT + SETPOINT_STEP, SETTLE_MS + HOLD_MS) <= SETTLED_ERROR);
+	tip.ambient -= LOAD_STEP;
+	CHECK(run(SETPOINT + SETPOINT_STEP, SETTLE_MS + HOLD_MS) <= SETTLED_ERROR);
+
+	CHECK(output_in_limits);
+}
+
+// At steady state, the same regulator state gets the old and a stepped setpoint with the same measurement.
+// The outputs may only differ by the proportional and the integral step, the derivative acts on the measurement
+static void test_no_derivative_kick(void) {
+	out_min = 0;
+	out_max = PID_OUTPUT_MAX;
+	pid_init(&pid, KP, KI, KD, out_min, out_max);
+	tip_plant_init(&tip, PLANT_GAIN, PLANT_TAU_MS, PLANT_DEAD_TIME_MS, AMBIENT);
+	run(SETPOINT, 2 * SETTLE_MS);
+
+	int16_t measurement = tip_plant_read(&tip);
+	pid_controller stepped = pid;
+	int32_t output = pid_update(&pid, SETPOINT, measurement, PID_INTERVAL_MS);
+	int32_t stepped_output = pid_update(&stepped, SETPOINT + SETPOINT_STEP, measurement, PID_INTERVAL_MS);
+	int32_t expected_step = KP * SETPOINT_STEP + ((KI * SETPOINT_STEP * PID_INTERVAL_MS) >> PID_TIME_BASE_SHIFT);
+	CHECK(abs(stepped_output - output - expected_step) <= 1);	// integrator fraction
+	CHECK(stepped_output < out_max);							// not hidden by the limit
+}
+
+// One regulator interval: pid_update() with the reading, then the plant runs with the output
+static int32_t run_pid(int16_t setpoint) {
+	int32_t output = pid_update(&pid, setpoint, tip_plant_read(&tip), PID_INTERVAL_MS);
+	if ((output < out_min) || (output > out_max)) {
+		output_in_limits = 0;
+	}
+	for (uint16_t i = 0; i < PID_INTERVAL_MS / TIP_PLANT_STEP_MS; i++) {
+		tip_plant_step(&tip, output);
+	}
+	return output;
+}
+
+// Runs the loop for duration_ms, returns the largest error of the last HOLD_MS
+static int16_t run(int16_t setpoint, uint32_t duration_ms) {
+	int16_t max_error = 0;
+	for (uint32_t time_ms = 0; time_ms < duration_ms; time_ms += PID_INTERVAL_MS) {
+		int16_t error = abs(tip_plant_read(&tip) - setpoint);
+		if ((time_ms + HOLD_MS >= duration_ms) && (error > max_error)) {
+			max_error = error;
+		}
+		run_pid(setpoint);
+	}
+	return max_error;
+}
@@ -0,0 +1,175 @@
+/*
+ * scheduler_test.c
+ *
+ * Checks the cooperative scheduler of scheduler.c on a simulated ms tick and µs clock
+ * - a task busy half of its period shows 50% load and the exact runtimes after 100 and 200 simulated minutes
+ *   (100 minutes of runtime, 32 bit µs counters wrapped after 71 minutes)
+ * - one-shot tasks run once per trigger, a trigger before the run moves the deadline, a task can re-trigger itself
+ * - an early periodic run by scheduler_trigger(), earliest deadline first, overruns
+ */
+
+#include "scheduler.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+#define LOAD_PERIOD_MS		10
+#define LOAD_RUNTIME_US		5000
+#define LOAD_DURATION_MS	(100UL * 60 * 1000)
+
+/******    Variables    ******/
+static scheduler tasks;
+static uint32_t now_ms;
+static uint32_t clock_us;		// simulated µs time, the scheduler sees the low 16 bit
+static uint32_t runs[2];
+static uint32_t run_order;		// task numbers in run order, one decimal digit each
+static uint8_t self_trigger_task;
+
+/******    Local Function Declarations    ******/
+static void test_load(void);
+static void test_one_shot(void);
+static void test_periodic(void);
+static void run_until(uint32_t end_ms);
+static uint16_t simulated_clock_us(void);
+static void busy_task(void);
+static void task_0(void);
+static void task_1(void);
+static void self_trigger(void);
+
+/******    functions    ******/
+int main(void) {
+	test_load();
+	test_one_shot();
+	test_periodic();
+	return test_result("scheduler_test");
+}
+
+// 5ms of runtime every 10ms: load 512 (Q10) and an average runtime of exactly 5000µs after 100 and 200 minutes
+static void test_load(void) {
+	now_ms = 0;
+	scheduler_init(&tasks, simulated_clock_us, now_ms);
+	scheduler_add_task(&tasks, busy_task, "busy", LOAD_PERIOD_MS, LOAD_PERIOD_MS);
+	const scheduler_task *task = scheduler_get_task(&tasks, 0);
+
+	for (uint8_t i = 1; i <= 2; i++) {
+		run_until(i * LOAD_DURATION_MS);
+		CHECK(task->runs == i * LOAD_DURATION_MS / LOAD_PERIOD_MS);
+		CHECK(task->total_runtime_us == (uint64_t)LOAD_RUNTIME_US * task->runs);
+		CHECK(task->total_runtime_us / task->runs == LOAD_RUNTIME_US);
+		CHECK(task->max_runtime_us == LOAD_RUNTIME_US);
+		CHECK((task->overruns == 0) && (task->max_lateness_ms == 0));
+		CHECK(scheduler_get_load(&tasks, now_ms) == (1 << SCHEDULER_LOAD_SHIFT) / 2);
+	}
+
+	scheduler_reset_stats(&tasks, now_ms);
+	CHECK((task->runs == 0) && (task->total_runtime_us == 0));
+	run_until(now_ms + 1000);
+	CHECK(scheduler_get_load(&tasks, now_ms) == (1 << SCHEDULER_LOAD_SHIFT) / 2);
+}
+
+static void test_one_shot(void) {
+	now_ms = 0;
+	runs[0] = 0;
+	runs[1] = 0;
+	scheduler_init(&tasks, simulated_clock_us, now_ms);
+	uint8_t one_shot = scheduler_add_task(&tasks, task_0, "one_shot", 0, 100);
+
+	run_until(99);
+	CHECK(runs[0] == 0);
+	run_until(1000);
+	CHECK(runs[0] == 1);		// once, not again
+
+	scheduler_trigger(&tasks, one_shot, now_ms, 50);
+	run_until(now_ms + 49);
+	CHECK(runs[0] == 1);
+	run_until(now_ms + 1000);
+	CHECK(runs[0] == 2);
+
+	// Triggered again before it ran: the deadline moves, one run after the last trigger
+	scheduler_trigger(&tasks, one_shot, now_ms, 50);
+	run_until(now_ms + 30);
+	scheduler_trigger(&tasks, one_shot, now_ms, 50);
+	run_until(now_ms + 30);
+	CHECK(runs[0] == 2);
+	run_until(now_ms + 20);
+	CHECK(runs[0] == 3);
+	run_until(now_ms + 1000);
+	CHECK(runs[0] == 3);
+
+	scheduler_trigger(&tasks, SCHEDULER_MAX_TASKS, now_ms, 0);	// no such task, ignored
+	scheduler_trigger(&tasks, one_shot + 1, now_ms, 0);
+	CHECK(scheduler_get_task(&tasks, one_shot + 1) == 0);
+
+	// A one-shot task re-arms itself from its run, every 20ms
+	uint32_t start_ms = now_ms;
+	self_trigger_task = scheduler_add_task(&tasks, self_trigger, "self_trigger", 0, start_ms + 20);
+	run_until(start_ms + 100);
+	CHECK(runs[1] == 100 / 20);
+	CHECK(scheduler_get_task(&tasks, self_trigger_task)->deadline_ms == start_ms + 120);
+}
+
+static void test_periodic(void) {
+	now_ms = 0;
+	runs[0] = 0;
+	runs[1] = 0;
+	run_order = 0;
+	scheduler_init(&tasks, simulated_clock_us, now_ms);
+	uint8_t periodic = scheduler_add_task(&tasks, task_0, "periodic", 100, 100);
+	scheduler_add_task(&tasks, task_1, "other", 100, 90);
+
+	// Both due at once: the earlier deadline runs first, one task per scheduler_run()
+	now_ms = 150;
+	CHECK(scheduler_run(&tasks, now_ms));
+	CHECK(run_order == 1);
+	CHECK(scheduler_run(&tasks, now_ms));
+	CHECK(run_order == 10);
+	CHECK(!scheduler_run(&tasks, now_ms));
+	CHECK(scheduler_get_task(&tasks, 1)->max_lateness_ms == 60);
+
+	// An early run moves the period
+	scheduler_trigger(&tasks, periodic, now_ms, 10);
+	run_until(160);
+	CHECK(runs[0] == 2);
+	CHECK(scheduler_get_task(&tasks, periodic)->deadline_ms == 260);
+
+	// A whole period late: one overrun, the next run is a period from now instead of catching up
+	now_ms = 500;
+	CHECK(scheduler_run(&tasks, now_ms));
+	CHECK(scheduler_run(&tasks, now_ms));
+	CHECK(!scheduler_run(&tasks, now_ms));
+	CHECK(scheduler_get_task(&tasks, periodic)->overruns == 1);
+	CHECK(scheduler_get_task(&tasks, periodic)->deadline_ms == 600);
+	CHECK(runs[0] == 3);
+}
+
+// Runs the due tasks every ms up to end_ms, like the main loop between two SysTicks
+static void run_until(uint32_t end_ms) {
+	while (now_ms != end_ms) {
+		now_ms++;
+		clock_us = now_ms * 1000;
+		while (scheduler_run(&tasks, now_ms)) {
+		}
+	}
+}
+
+static uint16_t simulated_clock_us(void) {
+	return (uint16_t)clock_us;
+}
+
+static void busy_task(void) {
+	clock_us += LOAD_RUNTIME_US;
+}
+
+static void task_0(void) {
+	runs[0]++;
+	run_order = run_order * 10;
+}
+
+static void task_1(void) {
+	runs[1]++;
+	run_order = run_order * 10 + 1;
+}
+
+static void self_trigger(void) {
+	runs[1]++;
+	scheduler_trigger(&tasks, self_trigger_task, now_ms, 20);
+}
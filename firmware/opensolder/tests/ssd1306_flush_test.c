@@ -0,0 +1,131 @@
+/*
+ * ssd1306_flush_test.c
+ *
+ * Byte count test of ssd1306_UpdateScreen(): the frames are sent through the SPI DMA stand-in
+ * of ssd1306_stub.c, which decodes them into a display RAM like the controller
+ * - a full screen fill sends the 1024 bytes of the screen and the 6 address window command bytes of every page
+ * - an unchanged frame sends nothing
+ * - a single glyph sends only the pages and columns it changes
+ */
+
+#include <string.h>
+#include "ssd1306_stub.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+#define COMMAND_BYTES_PER_PAGE	6	// column and page address window
+#define POISON					0xA5	// display RAM outside the area a frame may write
+
+#define GLYPH					'8'
+#define GLYPH_X					37
+#define GLYPH_Y					21		// not page aligned, rows 21..38 are pages 2..4
+
+/******    Variables    ******/
+static uint32_t frame_data_bytes;
+static uint32_t frame_command_bytes;
+
+/******    Local Function Declarations    ******/
+static void send_frame(void);
+static uint8_t display_ram_filled(uint8_t value);
+static uint8_t glyph_pixel(FontDef Font, char ch, uint8_t x, uint8_t y);
+
+/******    functions    ******/
+int main(void) {
+	memset(stub_display_ram, POISON, sizeof(stub_display_ram));		// undefined after reset
+	ssd1306_Init();
+	stub_spi_complete();
+	CHECK(display_ram_filled(0x00));
+	CHECK(stub_data_bytes == SSD1306_BUFFER_SIZE);
+
+	// Full screen fill
+	ssd1306_Fill(White);
+	CHECK(ssd1306_GetDirtyBytes() == SSD1306_BUFFER_SIZE);
+	send_frame();
+	CHECK(frame_data_bytes == SSD1306_BUFFER_SIZE);
+	CHECK(frame_command_bytes == SSD1306_PAGES * COMMAND_BYTES_PER_PAGE);
+	CHECK(display_ram_filled(0xFF));
+
+	// Unchanged frame, the same content drawn again
+	ssd1306_Fill(White);
+	send_frame();
+	CHECK(frame_data_bytes == 0);
+	CHECK(frame_command_bytes == 0);
+	CHECK(ssd1306_IsFlushBusy() == 0);
+
+	// Single glyph on a cleared screen, the RAM outside its box must not be written
+	ssd1306_Fill(Black);
+	send_frame();
+	CHECK(display_ram_filled(0x00));
+	uint8_t first_page = GLYPH_Y / 8;
+	uint8_t last_page = (GLYPH_Y + Font_11x18.FontHeight - 1) / 8;
+	for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+		for (uint8_t x = 0; x < SSD1306_WIDTH; x++) {
+			if ((page < first_page) || (page > last_page) || (x < GLYPH_X) || (x >= GLYPH_X + Font_11x18.FontWidth)) {
+				stub_display_ram[page][x] = POISON;
+			}
+		}
+	}
+
+	ssd1306_SetCursor(GLYPH_X, GLYPH_Y);
+	CHECK(ssd1306_WriteChar(GLYPH, Font_11x18, White) == GLYPH);
+	uint16_t dirty_bytes = ssd1306_GetDirtyBytes();
+	send_frame();
+	CHECK(frame_data_bytes == dirty_bytes);
+	CHECK(frame_data_bytes > 0);
+	CHECK(frame_data_bytes <= (last_page - first_page + 1) * Font_11x18.FontWidth);
+	CHECK(frame_command_bytes == (last_page - first_page + 1) * COMMAND_BYTES_PER_PAGE);
+
+	uint8_t outside_untouched = 1;
+	uint8_t glyph_shown = 1;
+	for (uint8_t y = 0; y < SSD1306_HEIGHT; y++) {
+		for (uint8_t x = 0; x < SSD1306_WIDTH; x++) {
+			uint8_t pixel = (stub_display_ram[y / 8][x] >> (y % 8)) & 1;
+			if ((y / 8 < first_page) || (y / 8 > last_page) || (x < GLYPH_X) || (x >= GLYPH_X + Font_11x18.FontWidth)) {
+				outside_untouched &= (stub_display_ram[y / 8][x] == POISON);
+			} else if ((y >= GLYPH_Y) && (y < GLYPH_Y + Font_11x18.FontHeight)) {
+				glyph_shown &= (pixel == glyph_pixel(Font_11x18, GLYPH, x - GLYPH_X, y - GLYPH_Y));
+			} else {
+				glyph_shown &= (pixel == 0);
+			}
+		}
+	}
+	CHECK(outside_untouched);
+	CHECK(glyph_shown);
+
+	// The same glyph again
+	ssd1306_SetCursor(GLYPH_X, GLYPH_Y);
+	ssd1306_WriteChar(GLYPH, Font_11x18, White);
+	send_frame();
+	CHECK(frame_data_bytes == 0);
+
+	return test_result("ssd1306_flush_test");
+}
+
+// Starts a flush and runs its DMA transfers to the end, counts the bytes of the frame
+static void send_frame(void) {
+	uint32_t data_bytes = stub_data_bytes;
+	uint32_t command_bytes = stub_command_bytes;
+	ssd1306_UpdateScreen();
+	stub_spi_complete();
+	CHECK(ssd1306_IsFlushBusy() == 0);
+	frame_data_bytes = stub_data_bytes - data_bytes;
+	frame_command_bytes = stub_command_bytes - command_bytes;
+}
+
+static uint8_t display_ram_filled(uint8_t value) {
+	for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+		for (uint8_t x = 0; x < SSD1306_WIDTH; x++) {
+			if (stub_display_ram[page][x] != value) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// Pixel of a glyph in the page layout of ssd1306_font_pages.c
+static uint8_t glyph_pixel(FontDef Font, char ch, uint8_t x, uint8_t y) {
+	uint8_t glyph_pages = (Font.FontHeight + 7) / 8;
+	const uint8_t *glyph = &Font.data[(ch - 32) * Font.FontWidth * glyph_pages];
+	return (glyph[(y / 8) * Font.FontWidth + x] >> (y % 8)) & 1;
+}
@@ -0,0 +1,119 @@
+/*
+ * ssd1306_font_test.c
+ *
+ * Snapshot test of ssd1306_WriteChar(): every printable char of every font is drawn at
+ * every cursor row, so at all unaligned page offsets, with the per pixel path of the row
+ * font tables (ssd1306_WriteChar() before the page fonts) and with the masked page path.
+ * The screenbuffers, dirty ranges, cursors and return values have to match.
+ *
+ * NOTES:
+ * - Built with SSD1306_INCLUDE_FONT_ROWS, the row tables of ssd1306_fonts.c are not in the firmware
+ * - ssd1306.c is included to compare its static screenbuffer and dirty ranges
+ */
+
+#include "../Drivers/ssd1306/src/ssd1306.c"
+#include "ssd1306_stub.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+typedef struct {
+	FontDef font;
+	const uint16_t *rows;	// source table of the same font, one uint16_t per glyph row
+} test_font;
+
+static const uint8_t test_columns[] = {0, 1, 5, 63, 100, 117, 122, 127};	// with columns too close to the right edge
+
+/******    Variables    ******/
+static uint8_t background[SSD1306_BUFFER_SIZE];
+static uint8_t reference_buffer[SSD1306_BUFFER_SIZE];
+static uint8_t reference_dirty_start[SSD1306_PAGES];
+static uint8_t reference_dirty_end[SSD1306_PAGES];
+
+/******    Local Function Declarations    ******/
+static char reference_write_char(char ch, FontDef Font, const uint16_t *rows, SSD1306_COLOR color);
+static void load_background(void);
+
+/******    functions    ******/
+int main(void) {
+	test_font fonts[] = {
+		{Font_6x8, Font6x8},
+		{Font_7x10, Font7x10},
+		{Font_11x18, Font11x18},
+		{Font_16x26, Font16x26},
+	};
+
+	// Random background, the glyph box has to overwrite it and leave the rest
+	srand(1);
+	for (uint16_t i = 0; i < sizeof(background); i++) {
+		background[i] = rand();
+	}
+
+	for (uint8_t f = 0; f < sizeof(fonts) / sizeof(fonts[0]); f++) {
+		for (int ch = 31; ch <= 127; ch++) {	// 31 and 127 are rejected
+			for (uint8_t y = 0; y < SSD1306_HEIGHT; y++) {
+				for (uint8_t c = 0; c < sizeof(test_columns); c++) {
+					for (uint8_t inverted = 0; inverted < 2; inverted++) {
+						for (uint8_t color = Black; color <= White; color++) {
+							SSD1306.Inverted = inverted;
+
+							load_background();
+							ssd1306_SetCursor(test_columns[c], y);
+							char reference_result = reference_write_char(ch, fonts[f].font, fonts[f].rows, color);
+							uint8_t reference_x = SSD1306.CurrentX;
+							memcpy(reference_buffer, SSD1306_Buffer, sizeof(reference_buffer));
+							memcpy(reference_dirty_start, SSD1306_DirtyStart, sizeof(reference_dirty_start));
+							memcpy(reference_dirty_end, SSD1306_DirtyEnd, sizeof(reference_dirty_end));
+
+							load_background();
+							ssd1306_SetCursor(test_columns[c], y);
+							char result = ssd1306_WriteChar(ch, fonts[f].font, color);
+
+							uint8_t match = (result == reference_result) && (SSD1306.CurrentX == reference_x)
+									&& !memcmp(SSD1306_Buffer, reference_buffer, sizeof(reference_buffer))
+									&& !memcmp(SSD1306_DirtyStart, reference_dirty_start, sizeof(reference_dirty_start))
+									&& !memcmp(SSD1306_DirtyEnd, reference_dirty_end, sizeof(reference_dirty_end));
+							if (!match) {
+								printf("font %ux%u char %d x %u y %u color %u inverted %u\n", fonts[f].font.FontWidth,
+										fonts[f].font.FontHeight, ch, test_columns[c], y, color, inverted);
+							}
+							CHECK(match);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return test_result("ssd1306_font_test");
+}
+
+// ssd1306_WriteChar() of the row font tables, one ssd1306_DrawPixel() per glyph pixel
+static char reference_write_char(char ch, FontDef Font, const uint16_t *rows, SSD1306_COLOR color) {
+	if (ch < 32 || ch > 126) {
+		return 0;
+	}
+	if (SSD1306_WIDTH < (SSD1306.CurrentX + Font.FontWidth) || SSD1306_HEIGHT < (SSD1306.CurrentY + Font.FontHeight)) {
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < Font.FontHeight; i++) {
+		uint32_t b = rows[(ch - 32) * Font.FontHeight + i];
+		for (uint32_t j = 0; j < Font.FontWidth; j++) {
+			if ((b << j) & 0x8000) {
+				ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR) color);
+			} else {
+				ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR) !color);
+			}
+		}
+	}
+
+	SSD1306.CurrentX += Font.FontWidth;
+	return ch;
+}
+
+// Screenbuffer with the random background and nothing dirty
+static void load_background(void) {
+	memcpy(SSD1306_Buffer, background, sizeof(background));
+	memset(SSD1306_DirtyStart, UINT8_MAX, sizeof(SSD1306_DirtyStart));
+	memset(SSD1306_DirtyEnd, 0, sizeof(SSD1306_DirtyEnd));
+}
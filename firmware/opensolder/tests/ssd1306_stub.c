@@ -0,0 +1,139 @@
+/*
+ * ssd1306_stub.c
+ *
+ * Host stand-in for the HAL calls of the ssd1306 driver, see ssd1306_stub.h
+ */
+
+#include "ssd1306_stub.h"
+
+/******    Variables    ******/
+SPI_HandleTypeDef hspi1;
+
+uint8_t stub_display_ram[SSD1306_PAGES][SSD1306_WIDTH];
+uint32_t stub_data_bytes = 0;
+uint32_t stub_command_bytes = 0;
+
+static GPIO_PinState dc_state = GPIO_PIN_RESET;		// command / data select pin
+static uint8_t command[3];
+static uint8_t command_length = 0;
+static uint8_t column_start = 0;
+static uint8_t column_end = SSD1306_WIDTH - 1;
+static uint8_t page_start = 0;
+static uint8_t page_end = SSD1306_PAGES - 1;
+static uint8_t column = 0;
+static uint8_t page = 0;
+
+static uint8_t *dma_data = NULL;		// queued DMA transfer
+static uint16_t dma_size = 0;
+static uint32_t tick_ms = 0;
+
+/******    Local Function Declarations    ******/
+static void stub_receive(uint8_t *data, uint16_t size);
+static void stub_command(uint8_t byte);
+static void stub_data(uint8_t byte);
+
+/******    functions    ******/
+void stub_spi_complete(void) {
+	while (dma_data != NULL) {
+		uint8_t *data = dma_data;
+		dma_data = NULL;
+		stub_receive(data, dma_size);
+		HAL_SPI_TxCpltCallback(&hspi1);
+	}
+}
+
+static void stub_receive(uint8_t *data, uint16_t size) {
+	for (uint16_t i = 0; i < size; i++) {
+		if (dc_state == GPIO_PIN_SET) {
+			stub_data(data[i]);
+		} else {
+			stub_command(data[i]);
+		}
+	}
+}
+
+static void stub_command(uint8_t byte) {
+	stub_command_bytes++;
+	command[command_length++] = byte;
+
+	switch (command[0]) {
+	case 0x21:		// column address window
+		if (command_length == 3) {
+			column_start = command[1];
+			column_end = command[2];
+			column = column_start;
+			command_length = 0;
+		}
+		break;
+	case 0x22:		// page address window
+		if (command_length == 3) {
+			page_start = command[1];
+			page_end = command[2];
+			page = page_start;
+			command_length = 0;
+		}
+		break;
+	case 0x20:		// commands with one argument byte
+	case 0x81:
+	case 0x8D:
+	case 0xA8:
+	case 0xD3:
+	case 0xD5:
+	case 0xD9:
+	case 0xDA:
+	case 0xDB:
+		if (command_length == 2) {
+			command_length = 0;
+		}
+		break;
+	default:
+		command_length = 0;
+		break;
+	}
+}
+
+static void stub_data(uint8_t byte) {
+	stub_data_bytes++;
+	stub_display_ram[page][column] = byte;
+	if (column < column_end) {
+		column++;
+		return;
+	}
+	column = column_start;
+	page = (page < page_end) ? page + 1 : page_start;
+}
+
+/******    HAL    ******/
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+	if ((GPIOx == SSD1306_DC_Port) && (GPIO_Pin == SSD1306_DC_Pin)) {
+		dc_state = PinState;
+	}
+}
+
+void HAL_Delay(uint32_t Delay) {
+	tick_ms += Delay;
+}
+
+uint32_t HAL_GetTick(void) {
+	stub_spi_complete();
+	return tick_ms++;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+	stub_receive(pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size) {
+	if (dma_data != NULL) {
+		return HAL_BUSY;
+	}
+	dma_data = pData;
+	dma_size = Size;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi) {
+	dma_data = NULL;
+	return HAL_OK;
+}
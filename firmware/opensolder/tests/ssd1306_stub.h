@@ -0,0 +1,34 @@
+/*
+ * ssd1306_stub.h
+ *
+ * Host stand-in for the HAL calls of the ssd1306 driver (GPIO, SPI, SPI DMA and tick)
+ *
+ * USAGE:
+ * - Link ssd1306_stub.c instead of the HAL
+ * - Call stub_spi_complete() to finish the DMA transfers started by ssd1306_UpdateScreen()
+ * - Read the bytes sent since the start from stub_data_bytes and stub_command_bytes,
+ *   the screen content from stub_display_ram
+ *
+ * NOTES:
+ * - The bytes are decoded like the controller does in horizontal addressing mode: the column (0x21)
+ *   and page (0x22) address commands set the window, data bytes fill it column by column
+ * - HAL_SPI_Transmit_DMA() only queues the transfer. stub_spi_complete() sends it and calls
+ *   HAL_SPI_TxCpltCallback() like the DMA interrupt, until the driver starts no new transfer
+ * - HAL_GetTick() completes the queued transfers too, so the blocking driver calls don't wait forever
+ */
+
+#ifndef SSD1306_STUB_H_
+#define SSD1306_STUB_H_
+
+/******    Includes    ******/
+#include "ssd1306.h"
+
+/******    Constants and Objects    ******/
+extern uint8_t stub_display_ram[SSD1306_PAGES][SSD1306_WIDTH];
+extern uint32_t stub_data_bytes;
+extern uint32_t stub_command_bytes;
+
+/******    Function Declarations    ******/
+void stub_spi_complete(void);
+
+#endif /* SSD1306_STUB_H_ */
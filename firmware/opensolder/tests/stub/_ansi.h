@@ -0,0 +1,13 @@
+/*
+ * _ansi.h
+ *
+ * Host stand-in for the newlib header included by ssd1306.h
+ */
+
+#ifndef _ANSIDECL_H_
+#define _ANSIDECL_H_
+
+#define _BEGIN_STD_C
+#define _END_STD_C
+
+#endif /* _ANSIDECL_H_ */
@@ -0,0 +1,35 @@
+/*
+ * test.h
+ *
+ * Checks for the host tests
+ *
+ * USAGE:
+ * - CHECK(condition) in the test, a failed check prints its location and condition
+ * - Return test_result() from main(), non zero if a check failed
+ */
+
+#ifndef TEST_H_
+#define TEST_H_
+
+/******    Includes    ******/
+#include <stdio.h>
+
+/******    Constants and Objects    ******/
+static unsigned test_checks = 0;
+static unsigned test_failures = 0;
+
+#define CHECK(condition) do { \
+		test_checks++; \
+		if (!(condition)) { \
+			test_failures++; \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+/******    Function Declarations    ******/
+static inline int test_result(const char *name) {
+	printf("%s: %u checks, %u failed\n", name, test_checks, test_failures);
+	return test_failures ? 1 : 0;
+}
+
+#endif /* TEST_H_ */
@@ -0,0 +1,38 @@
+/*
+ * tip_plant.c
+ *
+ * Simulated soldering tip for the host tests, see tip_plant.h
+ */
+
+#include <math.h>
+#include "tip_plant.h"
+
+/******    functions    ******/
+void tip_plant_init(tip_plant *const self, double gain, double tau_ms, uint16_t dead_time_ms, double ambient) {
+	self->gain = gain;
+	self->tau_ms = tau_ms;
+	self->dead_time_ms = dead_time_ms;
+	self->ambient = ambient;
+	self->temperature = ambient;
+	for (uint16_t i = 0; i < TIP_PLANT_MAX_DEAD_TIME_MS / TIP_PLANT_STEP_MS; i++) {
+		self->delay_line[i] = 0;	// heater off during the dead time before the start
+	}
+	self->delay_index = 0;
+}
+
+void tip_plant_step(tip_plant *const self, int32_t output) {
+	uint16_t delay_steps = self->dead_time_ms / TIP_PLANT_STEP_MS;
+	int32_t delayed_output = output;
+	if (delay_steps > 0) {
+		delayed_output = self->delay_line[self->delay_index];
+		self->delay_line[self->delay_index] = output;
+		self->delay_index = (self->delay_index + 1) % delay_steps;
+	}
+
+	double steady_state = self->ambient + self->gain * delayed_output;
+	self->temperature = steady_state + (self->temperature - steady_state) * exp(-TIP_PLANT_STEP_MS / self->tau_ms);
+}
+
+int16_t tip_plant_read(const tip_plant *const self) {
+	return (int16_t)lround(self->temperature);
+}
@@ -0,0 +1,43 @@
+/*
+ * tip_plant.h
+ *
+ * Simulated soldering tip for the host tests: first order plus dead time plant
+ * tau * dy/dt = K * u(t - L) - y, y is the tip temperature above ambient, u the Q15 heater output
+ *
+ * USAGE:
+ * - Call tip_plant_init() with the plant parameters, the tip starts at ambient with the heater off
+ * - Call tip_plant_step() with the heater output every TIP_PLANT_STEP_MS
+ * - tip_plant_read() returns the temperature rounded to whole °C like the firmware reading
+ *
+ * NOTES:
+ * - The first order step is exact, the output acts after the dead time (delay line)
+ */
+
+#ifndef TIP_PLANT_H_
+#define TIP_PLANT_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum tip_plant_constants {
+	TIP_PLANT_STEP_MS = 10,
+	TIP_PLANT_MAX_DEAD_TIME_MS = 2000
+};
+
+typedef struct {
+	double gain;			// K, °C per Q15 output
+	double tau_ms;			// time constant
+	uint16_t dead_time_ms;	// L, multiple of TIP_PLANT_STEP_MS
+	double ambient;			// °C
+	double temperature;		// °C
+	int32_t delay_line[TIP_PLANT_MAX_DEAD_TIME_MS / TIP_PLANT_STEP_MS];
+	uint16_t delay_index;
+} tip_plant;
+
+/******    Function Declarations    ******/
+void tip_plant_init(tip_plant *const self, double gain, double tau_ms, uint16_t dead_time_ms, double ambient);
+void tip_plant_step(tip_plant *const self, int32_t output);
+int16_t tip_plant_read(const tip_plant *const self);
+
+#endif /* TIP_PLANT_H_ */
@@ -0,0 +1,235 @@
+/*
+ * zerocross_pll_test.c
+ *
+ * Checks the zero cross PLL of zerocross_pll.c on simulated mains edges with jitter, driven like timers.c:
+ * every optocoupler edge goes to zerocross_pll_edge(), a half cycle without edge calls zerocross_pll_coast()
+ * - acquisition and tracking at 50Hz and 60Hz, both slightly off the nominal frequency
+ * - noise edges outside the window are rejected without moving the prediction
+ * - up to ZEROCROSS_PLL_MAX_COAST missing edges are bridged, one more unlocks and the PLL acquires again
+ * - an edge to true zero cross offset change (calibration)
+ * - predictions and acquisition across the 16 bit timestamp wrap
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "zerocross_pll.h"
+#include "test.h"
+
+/******    Constants and Objects    ******/
+#define HALF_CYCLE_50HZ_US	10000
+#define HALF_CYCLE_60HZ_US	8333
+#define OFFSET_US			500		// optocoupler edge to true zero cross
+#define ZERO_TOLERANCE_US	20		// predicted to true zero cross, jitter of the edges included
+#define PERIOD_TOLERANCE_US	2
+#define SETTLE_HALF_CYCLES	100
+
+typedef struct {
+	double half_cycle_us;
+	double offset_us;
+	double zero;		// true zero cross of the current half cycle, µs
+	uint32_t count;		// half cycles so far, index of the jitter
+} mains;
+
+/******    Variables    ******/
+static zerocross_pll pll;
+static mains grid;
+
+/******    Local Function Declarations    ******/
+static void test_acquisition(uint16_t nominal_us, double half_cycle_us);
+static void test_noise_rejection(void);
+static void test_coasting(void);
+static void test_offset_change(void);
+static void test_timestamp_wrap(void);
+static void mains_init(double half_cycle_us, double offset_us, double first_zero);
+static uint8_t half_cycle_edge(void);
+static uint8_t half_cycle_missing(void);
+static uint16_t edge_timestamp(void);
+static uint16_t timestamp(double time_us);
+static int16_t zero_error(void);
+static int16_t next_zero_error(void);
+static int16_t track(uint32_t half_cycles);
+
+/******    functions    ******/
+int main(void) {
+	test_acquisition(HALF_CYCLE_50HZ_US, 1e6 / 100.4);	// 50.2Hz
+	test_acquisition(HALF_CYCLE_60HZ_US, 1e6 / 119.6);	// 59.8Hz
+	test_noise_rejection();
+	test_coasting();
+	test_offset_change();
+	test_timestamp_wrap();
+	return test_result("zerocross_pll_test");
+}
+
+// The PLL follows the raw edges until ZEROCROSS_PLL_LOCK_EDGES plausible periods in a row, then tracks the frequency
+static void test_acquisition(uint16_t nominal_us, double half_cycle_us) {
+	zerocross_pll_init(&pll, nominal_us, OFFSET_US);
+	mains_init(half_cycle_us, OFFSET_US, 30000);	// the first edge is no plausible period after timestamp 0
+
+	for (uint8_t i = 0; i < ZEROCROSS_PLL_LOCK_EDGES; i++) {
+		CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+		CHECK(!zerocross_pll_is_locked(&pll));
+	}
+	CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+	CHECK(zerocross_pll_is_locked(&pll));
+
+	track(SETTLE_HALF_CYCLES);
+	CHECK(abs(track(SETTLE_HALF_CYCLES)) <= ZERO_TOLERANCE_US);
+	CHECK(abs(next_zero_error()) <= ZERO_TOLERANCE_US);
+	CHECK(fabs(zerocross_pll_get_period(&pll) - half_cycle_us) <= PERIOD_TOLERANCE_US);
+}
+
+// Edges outside ZEROCROSS_PLL_WINDOW_US of the prediction leave the PLL untouched
+static void test_noise_rejection(void) {
+	zerocross_pll_init(&pll, HALF_CYCLE_50HZ_US, OFFSET_US);
+	mains_init(HALF_CYCLE_50HZ_US, OFFSET_US, 30000);
+	track(SETTLE_HALF_CYCLES);
+	CHECK(zerocross_pll_is_locked(&pll));
+
+	uint16_t next_zero = zerocross_pll_get_next_zero(&pll);
+	double next_edge = grid.zero + grid.half_cycle_us - grid.offset_us;
+	const double noise[] = {grid.zero + 10, grid.zero + grid.half_cycle_us / 2,
+			next_edge - ZEROCROSS_PLL_WINDOW_US - 100, next_edge + ZEROCROSS_PLL_WINDOW_US + 100};
+	for (uint8_t i = 0; i < sizeof(noise) / sizeof(noise[0]); i++) {
+		CHECK(zerocross_pll_edge(&pll, timestamp(noise[i])) == ZEROCROSS_PLL_REJECTED);
+		CHECK(zerocross_pll_get_next_zero(&pll) == next_zero);
+	}
+	CHECK(zerocross_pll_is_locked(&pll));
+
+	CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+	CHECK(abs(zero_error()) <= ZERO_TOLERANCE_US);
+}
+
+// Missing edges are bridged with the tracked period, one more than ZEROCROSS_PLL_MAX_COAST in a row unlocks
+static void test_coasting(void) {
+	zerocross_pll_init(&pll, HALF_CYCLE_50HZ_US, OFFSET_US);
+	mains_init(1e6 / 99.6, OFFSET_US, 30000);	// 49.8Hz
+	track(SETTLE_HALF_CYCLES);
+
+	for (uint8_t i = 0; i < ZEROCROSS_PLL_MAX_COAST; i++) {
+		CHECK(half_cycle_missing());
+		CHECK(abs(zero_error()) <= ZERO_TOLERANCE_US);
+	}
+	CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+	CHECK(abs(zero_error()) <= ZERO_TOLERANCE_US);
+	CHECK(pll.coast_count == 0);
+
+	// The edge of a coasted half cycle comes after its timeout: it corrects the PLL, nothing is scheduled
+	CHECK(half_cycle_missing());
+	CHECK(zerocross_pll_edge(&pll, edge_timestamp() + 300) == ZEROCROSS_PLL_LATE);
+	CHECK(pll.coast_count == 0);
+	CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+
+	for (uint8_t i = 0; i < ZEROCROSS_PLL_MAX_COAST; i++) {
+		CHECK(half_cycle_missing());
+	}
+	CHECK(!half_cycle_missing());
+	CHECK(!zerocross_pll_is_locked(&pll));
+	CHECK(!half_cycle_missing());		// unlocked, nothing to bridge
+
+	// Acquires again: the first interval spans the missing edges, ZEROCROSS_PLL_LOCK_EDGES plausible ones follow
+	for (uint8_t i = 0; i < ZEROCROSS_PLL_LOCK_EDGES; i++) {
+		CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+		CHECK(!zerocross_pll_is_locked(&pll));
+	}
+	CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+	CHECK(zerocross_pll_is_locked(&pll));
+	track(SETTLE_HALF_CYCLES);
+	CHECK(abs(track(SETTLE_HALF_CYCLES)) <= ZERO_TOLERANCE_US);
+}
+
+// The calibration moves the predicted zero cross at once, the edges jumping with the new offset are tracked
+static void test_offset_change(void) {
+	zerocross_pll_init(&pll, HALF_CYCLE_50HZ_US, OFFSET_US);
+	mains_init(HALF_CYCLE_50HZ_US, OFFSET_US, 30000);
+	track(SETTLE_HALF_CYCLES);
+
+	uint16_t edge = pll.last_edge;
+	zerocross_pll_set_offset(&pll, OFFSET_US + 300);
+	CHECK(zerocross_pll_get_zero(&pll) == (uint16_t)(edge + OFFSET_US + 300));
+	grid.offset_us = OFFSET_US + 300;	// the optocoupler conducts 300µs earlier
+
+	CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+	track(SETTLE_HALF_CYCLES);
+	CHECK(zerocross_pll_is_locked(&pll));
+	CHECK(abs(track(SETTLE_HALF_CYCLES)) <= ZERO_TOLERANCE_US);
+	CHECK(abs(zerocross_pll_get_period(&pll) - HALF_CYCLE_50HZ_US) <= PERIOD_TOLERANCE_US);
+
+	zerocross_pll_set_offset(&pll, OFFSET_US);
+	grid.offset_us = OFFSET_US;
+	track(SETTLE_HALF_CYCLES);
+	CHECK(abs(track(SETTLE_HALF_CYCLES)) <= ZERO_TOLERANCE_US);
+}
+
+// Acquisition and a prediction crossing from 65535 to 0 of the free running timer
+static void test_timestamp_wrap(void) {
+	zerocross_pll_init(&pll, HALF_CYCLE_60HZ_US, OFFSET_US);
+	mains_init(1e6 / 120.2, OFFSET_US, 65536 - 2.5 * HALF_CYCLE_60HZ_US);	// 60.1Hz, wraps during acquisition
+	for (uint8_t i = 0; i <= ZEROCROSS_PLL_LOCK_EDGES; i++) {
+		half_cycle_edge();
+	}
+	CHECK(grid.zero > 65536);
+	CHECK(zerocross_pll_is_locked(&pll));
+	CHECK(fabs(zerocross_pll_get_period(&pll) - grid.half_cycle_us) <= 25);	// raw intervals, jitter included
+
+	track(SETTLE_HALF_CYCLES);
+	while (fmod(grid.zero, 65536) + grid.half_cycle_us < 65536) {
+		CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+	}
+	CHECK(zerocross_pll_get_next_zero(&pll) < zerocross_pll_get_zero(&pll));	// the next zero cross is past the wrap
+	CHECK(abs(next_zero_error()) <= ZERO_TOLERANCE_US);
+	CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+	CHECK(abs(zero_error()) <= ZERO_TOLERANCE_US);
+	CHECK(abs(track(SETTLE_HALF_CYCLES)) <= ZERO_TOLERANCE_US);
+}
+
+// The first half cycle ends at first_zero
+static void mains_init(double half_cycle_us, double offset_us, double first_zero) {
+	grid.half_cycle_us = half_cycle_us;
+	grid.offset_us = offset_us;
+	grid.zero = first_zero - half_cycle_us;
+	grid.count = 0;
+}
+
+// Next half cycle, the optocoupler edge reaches the PLL
+static uint8_t half_cycle_edge(void) {
+	grid.zero += grid.half_cycle_us;
+	grid.count++;
+	return zerocross_pll_edge(&pll, edge_timestamp());
+}
+
+// Next half cycle without an edge, the timeout at the predicted zero cross coasts
+static uint8_t half_cycle_missing(void) {
+	grid.zero += grid.half_cycle_us;
+	grid.count++;
+	return zerocross_pll_coast(&pll);
+}
+
+// Edge of the current half cycle with a repeatable +/-20µs jitter
+static uint16_t edge_timestamp(void) {
+	static const int8_t jitter[] = {0, 12, -9, 20, -15, 5, -20, 8, -4, 17, -12};
+	return timestamp(grid.zero - grid.offset_us + jitter[grid.count % sizeof(jitter)]);
+}
+
+static uint16_t timestamp(double time_us) {
+	return (uint16_t)(uint32_t)llround(time_us);
+}
+
+static int16_t zero_error(void) {
+	return (int16_t)(zerocross_pll_get_zero(&pll) - timestamp(grid.zero));
+}
+
+static int16_t next_zero_error(void) {
+	return (int16_t)(zerocross_pll_get_next_zero(&pll) - timestamp(grid.zero + grid.half_cycle_us));
+}
+
+// Half cycles with edges, returns the largest zero cross error
+static int16_t track(uint32_t half_cycles) {
+	int16_t max_error = 0;
+	for (uint32_t i = 0; i < half_cycles; i++) {
+		CHECK(half_cycle_edge() == ZEROCROSS_PLL_ACCEPTED);
+		if (abs(zero_error()) > abs(max_error)) {
+			max_error = zero_error();
+		}
+	}
+	return max_error;
+}
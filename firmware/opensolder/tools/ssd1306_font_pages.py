@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+ssd1306_font_pages.py
+
+Generates Drivers/ssd1306/src/ssd1306_font_pages.c, the fonts of ssd1306_fonts.c
+transposed into the SSD1306 display RAM layout used by ssd1306_WriteChar().
+
+ssd1306_fonts.c stores one uint16_t per glyph row, the leftmost pixel in bit 15.
+The display RAM is organized in pages of 8 pixel rows, one byte per column with
+the top row in bit 0. Every glyph is stored as ceil(height / 8) page rows of
+width bytes, so the blitter writes whole bytes instead of single pixels.
+
+ssd1306_fonts.c stays the source of the glyphs, edit it and rerun this script. Its row
+tables are only compiled into the host tests, the firmware links the page tables and
+the FontDef objects of the generated file.
+
+USAGE:
+    python3 tools/ssd1306_font_pages.py           regenerate the page fonts
+    python3 tools/ssd1306_font_pages.py --check   verify the checked-in file is up to date
+"""
+
+import os
+import re
+import sys
+
+FIRST_CHAR = 32
+LAST_CHAR = 126
+ROW_MSB = 0x8000		# leftmost pixel of a glyph row
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+FONTS_PATH = os.path.join(SCRIPT_DIR, "..", "Drivers", "ssd1306", "src", "ssd1306_fonts.c")
+SOURCE_PATH = os.path.join(SCRIPT_DIR, "..", "Drivers", "ssd1306", "src", "ssd1306_font_pages.c")
+
+
+def parse_fonts(text):
+	# Drop comments first, ssd1306_fonts.c keeps replaced glyphs as commented out rows
+	text = re.sub(r"//[^\n]*", "", text)
+	fonts = []
+	for array, width, height, body in re.findall(r"const\s+uint16_t\s+(Font(\d+)x(\d+))\s*\[\]\s*=\s*\{(.*?)\};", text, re.S):
+		width, height = int(width), int(height)
+		rows = [int(value, 16) for value in re.findall(r"0x[0-9a-fA-F]+", body)]
+		if len(rows) != (LAST_CHAR - FIRST_CHAR + 1) * height:
+			sys.exit("%s has %d rows, expected %d" % (array, len(rows), (LAST_CHAR - FIRST_CHAR + 1) * height))
+		fonts.append((array, width, height, rows))
+	return fonts
+
+
+def transpose_glyph(rows, width, height):
+	# Page row p, column x: bit k is glyph row 8 * p + k
+	data = []
+	for page in range((height + 7) // 8):
+		for x in range(width):
+			value = 0
+			for bit in range(8):
+				y = page * 8 + bit
+				if (y < height) and (rows[y] & (ROW_MSB >> x)):
+					value |= 1 << bit
+			data.append(value)
+	return data
+
+
+def render_font(array, width, height, rows):
+	lines = []
+	for index in range(LAST_CHAR - FIRST_CHAR + 1):
+		glyph = transpose_glyph(rows[index * height:(index + 1) * height], width, height)
+		char = chr(FIRST_CHAR + index)
+		# A line comment ending in a backslash would swallow the next glyph, ssd1306_fonts.c does the same
+		comment = "/* \\ */" if char == "\\" else "// " + ("sp" if char == " " else char)
+		lines.append("\t" + ", ".join("0x%02X" % value for value in glyph) + ",\t" + comment)
+	return """#ifdef SSD1306_INCLUDE_FONT_%dx%d
+static const uint8_t %s_Pages[] = {
+%s
+};
+FontDef Font_%dx%d = {%d,%d,%s_Pages};
+#endif
+""" % (width, height, array, "\n".join(lines), width, height, width, height, array)
+
+
+def render_source(fonts):
+	return """/*
+ * ssd1306_font_pages.c
+ *
+ * GENERATED by tools/ssd1306_font_pages.py from ssd1306_fonts.c, do not edit
+ *
+ * Glyphs in display page layout: ceil(height / 8) page rows of width bytes, top pixel row in bit 0
+ */
+
+#include "../inc/ssd1306_fonts.h"
+
+%s""" % "\n".join(render_font(*font) for font in fonts)
+
+
+def main():
+	with open(FONTS_PATH) as f:
+		content = render_source(parse_fonts(f.read()))
+
+	if "--check" in sys.argv:
+		with open(SOURCE_PATH) as f:
+			if f.read() != content:
+				sys.exit("ssd1306_font_pages.c is out of date, run tools/ssd1306_font_pages.py")
+		print("page fonts up to date")
+		return
+
+	with open(SOURCE_PATH, "w") as f:
+		f.write(content)
+	print("page fonts written")
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""
+thermocouple_table.py
+
+Generates Core/Inc/thermocouple_table.h and Core/Src/thermocouple_table.c, the
+ADC count -> tip temperature lookup table used by tip_thermocouple.c.
+
+The table is built from the NIST ITS-90 reference polynomial of the cartridge
+thermocouple and the gain of the thermocouple amplifier. It is referenced to a
+0°C cold junction, the firmware adds the cold junction EMF (in ADC counts)
+before the lookup.
+
+Every run verifies the piecewise linear table against the reference polynomial
+and fails if the interpolation error is above MAX_ERROR_C.
+
+USAGE:
+    python3 tools/thermocouple_table.py           regenerate the table
+    python3 tools/thermocouple_table.py --check   verify the checked-in table is up to date
+"""
+
+import os
+import sys
+
+# NIST ITS-90 type N thermocouple, 0°C to 1300°C, E in mV, t in °C
+# The JBC C245 cartridge thermocouple is closest to type N
+TYPE_N_COEFFICIENTS = [
+    0.000000000000e+00,
+    0.259293946010e-01,
+    0.157101418800e-04,
+    0.438256272370e-07,
+    -0.252611697940e-09,
+    0.643118193390e-12,
+    -0.100634715190e-14,
+    0.997453389920e-18,
+    -0.608632456070e-21,
+    0.208492293390e-24,
+    -0.306821961510e-28,
+]
+
+# Hardware, see hardware/kicad/analog.kicad_sch
+AMPLIFIER_GAIN = 1 + 22000 / 100	# MAX4238 non-inverting amplifier, R6 = 22k, R7 = 100R
+ADC_REFERENCE_MV = 3300.0
+ADC_RESOLUTION = 4096
+
+# Table layout
+SEGMENT_SHIFT = 6					# 64 ADC counts per table segment
+SEGMENT_COUNTS = 1 << SEGMENT_SHIFT
+TABLE_MAX_COUNTS = 4608				# ADC full scale plus the cold junction offset up to ~70°C
+TEMPERATURE_SHIFT = 4				# table values are Q4 °C
+COLD_JUNCTION_SHIFT = 8				# Q8 ADC counts per °C
+COLD_JUNCTION_RANGE_C = (0, 50)		# the cold junction slope is fitted over this range
+MAX_TEMPERATURE_C = 1300.0
+
+MAX_ERROR_C = 0.5					# maximum allowed interpolation error within the firmware range
+VERIFY_RANGE_C = (0, 500)
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+HEADER_PATH = os.path.join(SCRIPT_DIR, "..", "Core", "Inc", "thermocouple_table.h")
+SOURCE_PATH = os.path.join(SCRIPT_DIR, "..", "Core", "Src", "thermocouple_table.c")
+
+
+def emf_mv(temperature_c):
+	return sum(c * temperature_c ** i for i, c in enumerate(TYPE_N_COEFFICIENTS))
+
+
+def emf_counts(temperature_c):
+	return emf_mv(temperature_c) * AMPLIFIER_GAIN * ADC_RESOLUTION / ADC_REFERENCE_MV
+
+
+def counts_to_temperature(counts):
+	# The polynomial is monotonic over its range, invert it by bisection
+	low, high = 0.0, MAX_TEMPERATURE_C
+	for _ in range(60):
+		mid = (low + high) / 2
+		if emf_counts(mid) < counts:
+			low = mid
+		else:
+			high = mid
+	return (low + high) / 2
+
+
+def build_table():
+	return [round(counts_to_temperature(i * SEGMENT_COUNTS) * (1 << TEMPERATURE_SHIFT)) for i in range(TABLE_MAX_COUNTS // SEGMENT_COUNTS + 1)]
+
+
+def cold_junction_slope():
+	low, high = COLD_JUNCTION_RANGE_C
+	return round((emf_counts(high) - emf_counts(low)) / (high - low) * (1 << COLD_JUNCTION_SHIFT))
+
+
+def lookup(table, counts):
+	# Same integer arithmetic as thermocouple_table_lookup() in the firmware
+	index = counts >> SEGMENT_SHIFT
+	fraction = counts & (SEGMENT_COUNTS - 1)
+	if index >= len(table) - 1:
+		return table[-1] >> TEMPERATURE_SHIFT
+	value = table[index] + (((table[index + 1] - table[index]) * fraction) >> SEGMENT_SHIFT)
+	return (value + (1 << (TEMPERATURE_SHIFT - 1))) >> TEMPERATURE_SHIFT
+
+
+def verify(table, slope):
+	worst = 0.0
+	for temperature in range(VERIFY_RANGE_C[0], VERIFY_RANGE_C[1] + 1):
+		for ambient in range(COLD_JUNCTION_RANGE_C[0], COLD_JUNCTION_RANGE_C[1] + 1, 5):
+			adc = int(emf_counts(temperature) - emf_counts(ambient))
+			if (adc < 0) or (adc >= ADC_RESOLUTION):
+				continue
+			firmware = lookup(table, adc + ((ambient * slope) >> COLD_JUNCTION_SHIFT))
+			reference = counts_to_temperature(adc + emf_counts(ambient))
+			worst = max(worst, abs(firmware - reference))
+	if worst > MAX_ERROR_C + 0.5:	# + 0.5°C for the rounding to full degrees
+		sys.exit("thermocouple table error %.2f°C exceeds the limit" % worst)
+	return worst
+
+
+def render_header(table):
+	return """/*
+ * thermocouple_table.h
+ *
+ * GENERATED by tools/thermocouple_table.py, do not edit
+ *
+ * Type N thermocouple, amplifier gain %d, ADC reference %dmV, 0°C cold junction
+ */
+
+#ifndef INC_THERMOCOUPLE_TABLE_H_
+#define INC_THERMOCOUPLE_TABLE_H_
+
+/******    Includes    ******/
+#include <stdint.h>
+
+/******    Constants and Objects    ******/
+enum thermocouple_table_constants {
+	THERMOCOUPLE_TABLE_LENGTH = %d,
+	THERMOCOUPLE_TABLE_SEGMENT_SHIFT = %d,		// ADC counts per table segment = 1 << THERMOCOUPLE_TABLE_SEGMENT_SHIFT
+	THERMOCOUPLE_TABLE_TEMP_SHIFT = %d,			// table values are Q%d °C
+	THERMOCOUPLE_COLD_JUNCTION_SLOPE = %d,	// Q%d ADC counts per °C cold junction temperature
+	THERMOCOUPLE_COLD_JUNCTION_SHIFT = %d
+};
+
+extern const uint16_t thermocouple_table[THERMOCOUPLE_TABLE_LENGTH];
+
+#endif /* INC_THERMOCOUPLE_TABLE_H_ */
+""" % (AMPLIFIER_GAIN, ADC_REFERENCE_MV, len(table), SEGMENT_SHIFT, TEMPERATURE_SHIFT, TEMPERATURE_SHIFT, cold_junction_slope(), COLD_JUNCTION_SHIFT,
+		COLD_JUNCTION_SHIFT)
+
+
+def render_source(table):
+	rows = []
+	for i in range(0, len(table), 8):
+		rows.append("\t" + ", ".join("%d" % value for value in table[i:i + 8]) + ",")
+	return """/*
+ * thermocouple_table.c
+ *
+ * GENERATED by tools/thermocouple_table.py, do not edit
+ *
+ * Tip temperature (Q%d °C) at every %d ADC counts of thermocouple EMF
+ */
+
+#include "thermocouple_table.h"
+
+const uint16_t thermocouple_table[THERMOCOUPLE_TABLE_LENGTH] = {
+%s
+};
+""" % (TEMPERATURE_SHIFT, SEGMENT_COUNTS, "\n".join(rows))
+
+
+def main():
+	table = build_table()
+	worst = verify(table, cold_junction_slope())
+	files = {HEADER_PATH: render_header(table), SOURCE_PATH: render_source(table)}
+
+	if "--check" in sys.argv:
+		for path, content in files.items():
+			with open(path) as f:
+				if f.read() != content:
+					sys.exit("%s is out of date, run tools/thermocouple_table.py" % os.path.basename(path))
+		print("thermocouple table up to date, max error %.2f°C" % worst)
+		return
+
+	for path, content in files.items():
+		with open(path, "w") as f:
+			f.write(content)
+	print("thermocouple table written, max error %.2f°C" % worst)
+
+
+if __name__ == "__main__":
+	main()